@@ -7,8 +7,22 @@
 using namespace cv;
 using namespace std;
 
-class Segment;
 class Map;
+struct BoxBatch;
+
+// Render-free description of a single segment. Curves are assumed to use the
+// turn radius of whoever replays the record.
+struct EdgeRecord
+{
+	float length;
+	float angle;
+	signed char direction;
+	bool isCurve;
+	bool right;
+
+	// The same motion driven in the opposite direction.
+	inline EdgeRecord reversed() const { return EdgeRecord{ this->length, -this->angle, (signed char)-this->direction, this->isCurve, this->right }; }
+};
 
 class AbstractSegment
 {
@@ -34,7 +48,10 @@ public:
 	inline void restoreLastStep() { this->currentSegmentPos = this->prevSegmentPos; }
 	virtual const Vec2f& getEndOri() = 0;
 	virtual void truncateNow() = 0;
-	virtual Segment* WTFNewSegment(Map* map) = 0;
+	virtual EdgeRecord toRecord() const = 0;
+	// Fills boxes with collision boxes that together cover the vehicle driving the whole segment.
+	// The vehicle box extends halfLength and halfWidth around a center centerOffset ahead of the pose.
+	virtual void sweep(float centerOffset, float halfLength, float halfWidth, BoxBatch& boxes) const = 0;
 
 	virtual ~AbstractSegment() {};
 
@@ -54,7 +71,8 @@ public:
 	const Vec2f& getEndOri() { return this->startOri; }
 	int getDirection() { return this->direction; }
 	void truncateNow();
-	virtual Segment* WTFNewSegment(Map* map);
+	virtual EdgeRecord toRecord() const;
+	virtual void sweep(float centerOffset, float halfLength, float halfWidth, BoxBatch& boxes) const;
 
 	friend class LinearSegment;
 };
@@ -78,7 +96,8 @@ public:
 
 	virtual bool step(float& stepLength, Point2f& newPos, Vec2f& newOri);
 	void truncateNow();
-	virtual Segment* WTFNewSegment(Map* map);
+	virtual EdgeRecord toRecord() const;
+	virtual void sweep(float centerOffset, float halfLength, float halfWidth, BoxBatch& boxes) const;
 
 	friend class CurveSegment;
 };
@@ -102,7 +121,14 @@ private:
 	int activeSegment;
 	int prevActiveSegment;
 
+	// Number of steps handed to Map::checkCollision at once by truncate.
+	static const int collisionBatchSize = 16;
+
 	void truncateNow();
+	bool step(int count);
+	float maxPointSpeed(float along, float across);
+	bool sweepFree(Map* map, float safety);
+	bool probeHits(Map* map, float truncLength, float safety);
 public:
 	AbstractTrajectory(const Point2f& startPos, const Vec2f& startOri, float stepLength = 1.0);
 	virtual ~AbstractTrajectory();
@@ -122,14 +148,18 @@ public:
 	void resetState();
 	LinearAbstractSegment* addLinearSegment(float length, bool forward = true);
 	CurveAbstractSegment* addCurveSegment(float angle, float radius, bool rigth);
+	void addRecord(const EdgeRecord& record, float radius);
 	void removeLastSegment();
 	void clear();
 	bool step();
 	void restoreLastStep();
 	bool truncate(Map* map, float truncLength, bool& truncated, float stepsize, bool useChunk = false);
+	// Truncates to truncLength like truncate does, but without any collision check.
+	void cut(float truncLength, bool& truncated);
 
 	friend class Trajectory;
 	friend class RamTreeNode;
+	friend class RamTree;
 };
 
 #endif // ABSTRACT_TRAJECTORY_H
@@ -0,0 +1,85 @@
+#ifndef APPENDARRAY_H
+#define APPENDARRAY_H
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+using namespace std;
+
+// Append-only array that several threads can grow at once without locks. Elements live in
+// fixed-size chunks, so their addresses never change. Writers claim a range of slots, fill
+// it and publish it; ranges become visible in claim order, so size() is always a prefix of
+// fully written elements that readers can use as a consistent snapshot.
+template<class T, int ChunkBits = 12>
+class AppendArray
+{
+	static_assert(is_trivially_destructible<T>::value, "AppendArray only holds plain records");
+private:
+	static const size_t chunkSize = size_t(1) << ChunkBits;
+	static const size_t maxChunks = 4096;
+
+	atomic<T*> chunks[maxChunks];
+	atomic<size_t> claimed;
+	atomic<size_t> published;
+
+	AppendArray(const AppendArray&) = delete;
+	AppendArray& operator=(const AppendArray&) = delete;
+
+	void allocateChunk(size_t c)
+	{
+		if (c >= maxChunks)
+			throw runtime_error("AppendArray capacity exceeded.");
+		T* chunk = this->chunks[c].load(memory_order_acquire);
+		if (chunk)
+			return;
+		T* fresh = new T[chunkSize];
+		if (!this->chunks[c].compare_exchange_strong(chunk, fresh, memory_order_acq_rel))
+			delete[] fresh;
+	}
+public:
+	AppendArray() : claimed(0), published(0)
+	{
+		for (size_t c = 0; c < maxChunks; c++)
+			this->chunks[c].store(0, memory_order_relaxed);
+	}
+
+	~AppendArray()
+	{
+		for (size_t c = 0; c < maxChunks; c++)
+			delete[] this->chunks[c].load(memory_order_relaxed);
+	}
+
+	// Reserves n consecutive slots and returns the index of the first one.
+	size_t claim(size_t n = 1)
+	{
+		size_t first = this->claimed.fetch_add(n, memory_order_relaxed);
+		if (n)
+			for (size_t c = first >> ChunkBits; c <= (first + n - 1) >> ChunkBits; c++)
+				this->allocateChunk(c);
+		return first;
+	}
+
+	// Makes a claimed range visible. Waits until every earlier range is published.
+	void publish(size_t first, size_t n = 1)
+	{
+		while (this->published.load(memory_order_acquire) != first)
+			this_thread::yield();
+		this->published.store(first + n, memory_order_release);
+	}
+
+	size_t push_back(const T& value)
+	{
+		size_t i = this->claim();
+		(*this)[i] = value;
+		this->publish(i);
+		return i;
+	}
+
+	inline size_t size() const { return this->published.load(memory_order_acquire); }
+	inline T& operator[](size_t i) { return this->chunks[i >> ChunkBits].load(memory_order_relaxed)[i & (chunkSize - 1)]; }
+	inline const T& operator[](size_t i) const { return this->chunks[i >> ChunkBits].load(memory_order_relaxed)[i & (chunkSize - 1)]; }
+};
+
+#endif // APPENDARRAY_H
@@ -0,0 +1,55 @@
+#ifndef CSPACEMAP_H
+#define CSPACEMAP_H
+
+#include "ObstacleStore.h"
+
+#include <opencv2/core/mat.hpp>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+// Configuration space occupancy of the vehicle over a grid of positions and heading bins, computed
+// once for a map. A cell is free when the collision box grown by the distance any of its poses can
+// move away from the cell center is clear, and blocked when the box shrunk by that distance hits
+// an obstacle. Parking spots count as solid for the first test and are ignored for the second, so
+// the result holds whichever spot is the active target. Every other cell is left to the exact test.
+class CSpaceMap
+{
+public:
+	enum State
+	{
+		MIXED,
+		FREE,
+		BLOCKED,
+	};
+private:
+	float x_min;
+	float y_min;
+	float resolution;
+	float invResolution;
+	int cols;
+	int rows;
+	int headingBins;
+	float safety;
+	float centerOffset;
+	// Two bits of State per cell, cell (bin * rows + y) * cols + x.
+	vector<uint64_t> cells;
+public:
+	CSpaceMap() : x_min(0), y_min(0), resolution(0), invResolution(0), cols(0), rows(0), headingBins(0), safety(0), centerOffset(0) {};
+
+	// Classifies the poses within area for a collision box that extends halfLength and halfWidth,
+	// including the safety margin, around a center centerOffset ahead of the pose.
+	void build(const ObstacleStore& obstacles, const Rect2f& area, float resolution, int headingBins, float centerOffset, float halfLength, float halfWidth, float safety);
+	void clear();
+
+	inline bool isBuilt() const { return this->cols > 0; }
+	inline float getResolution() const { return this->resolution; }
+	inline int getHeadingBins() const { return this->headingBins; }
+	// State of the pose for a collision box with the given safety margin. A cell is only free for
+	// margins up to the one it was built with and only blocked for margins from it on.
+	State lookup(const Point2f& pos, const Vec2f& ori, float safety) const;
+};
+
+#endif // CSPACEMAP_H
@@ -0,0 +1,81 @@
+#ifndef COLLISIONBATCH_H
+#define COLLISIONBATCH_H
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+// Vehicle collision zones of several poses in structure-of-arrays layout. All boxes share their
+// half extents; each has a center and the unit vector of its length axis.
+struct BoxBatch
+{
+	vector<float> cx;
+	vector<float> cy;
+	vector<float> ux;
+	vector<float> uy;
+	float halfLength = 0;
+	float halfWidth = 0;
+
+	void clear();
+	void push_back(const Point2f& center, const Vec2f& ori);
+	inline int size() const { return (int)this->cx.size(); }
+};
+
+// Raw view of a BoxBatch handed to the instruction set specific kernels.
+struct BoxArrays
+{
+	const float* cx;
+	const float* cy;
+	const float* ux;
+	const float* uy;
+	float halfLength;
+	float halfWidth;
+	int count;
+};
+
+// Circles of equal size along the length axis that together cover a box, for the coarse tests
+// before the exact one.
+const int footprintCircles = 4;
+
+// Convex polygon or segment prepared for separating axis tests: its vertices, and for every edge
+// the normal with the interval the polygon covers along it. The center is the vertex average, which
+// lies on the shape, and the radius the circle around it holding the shape.
+struct ConvexShape
+{
+	Point2f points[4];
+	Vec2f normals[4];
+	float minProj[4];
+	float maxProj[4];
+	Point2f center;
+	float radius;
+	int size;
+	int axes;
+
+	ConvexShape(const Point2f* points, int size);
+};
+
+// Sets hits[i] for the first count boxes that overlap shape. Other entries are left as they are.
+// Uses AVX2 or SSE when the CPU has them.
+void collideBoxes(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits);
+
+// Whether the polygon has no reflex vertex, so that a separating axis test is exact for it.
+bool isConvex(const Point2f* points, int size);
+
+namespace collision_scalar
+{
+	void collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits);
+}
+
+namespace collision_sse
+{
+	void collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits);
+}
+
+namespace collision_avx2
+{
+	void collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits);
+}
+
+#endif // COLLISIONBATCH_H
@@ -0,0 +1,99 @@
+#ifndef COLLISIONBATCHKERNEL_H
+#define COLLISIONBATCHKERNEL_H
+
+// Separating axis test of many oriented boxes against one convex shape, written once for every
+// float vector type V. Include only after V and its helpers are defined, see SimdFloat.h.
+// Coarse tests go first: a box is clear when the circle around the shape misses the circle around
+// the box or all of its footprint circles, and hits when the shape center is inside it. The exact
+// test only runs when some box of a vector is left undecided.
+
+#include "CollisionBatch.h"
+
+#include <math.h>
+
+namespace
+{
+	template<class V> inline void collideKernel(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits)
+	{
+		const int width = V::width;
+		float tail[4][width];
+		float overlap[width];
+		V a(boxes.halfLength), b(boxes.halfWidth);
+		float step = boxes.halfLength / footprintCircles;
+		float boundReach = sqrt(boxes.halfLength * boxes.halfLength + boxes.halfWidth * boxes.halfWidth) + shape.radius;
+		float circleReach = sqrt(step * step + boxes.halfWidth * boxes.halfWidth) + shape.radius;
+		for (int i = 0; i < boxes.count; i += width)
+		{
+			int lanes = boxes.count - i < width ? boxes.count - i : width;
+			V cx, cy, ux, uy;
+			if (lanes == width)
+			{
+				cx = V::load(boxes.cx + i);
+				cy = V::load(boxes.cy + i);
+				ux = V::load(boxes.ux + i);
+				uy = V::load(boxes.uy + i);
+			}
+			else
+			{
+				for (int l = 0; l < width; l++)
+				{
+					int k = i + (l < lanes ? l : 0);
+					tail[0][l] = boxes.cx[k];
+					tail[1][l] = boxes.cy[k];
+					tail[2][l] = boxes.ux[k];
+					tail[3][l] = boxes.uy[k];
+				}
+				cx = V::load(tail[0]);
+				cy = V::load(tail[1]);
+				ux = V::load(tail[2]);
+				uy = V::load(tail[3]);
+			}
+
+			V sx = V(shape.center.x) - cx, sy = V(shape.center.y) - cy;
+			typename V::Mask hit = sx * sx + sy * sy <= V(boundReach * boundReach);
+			if (!hit.any())
+				continue;
+			V su = sx * ux + sy * uy;
+			V sv = sy * ux - sx * uy;
+			V closest(1e30f);
+			for (int c = 0; c < footprintCircles; c++)
+				closest = vmin(closest, vabs(su + a - V((2 * c + 1) * step)));
+			hit = hit & (closest * closest + sv * sv <= V(circleReach * circleReach));
+			if (!hit.any())
+				continue;
+
+			if ((hit & ((vabs(su) > a) | (vabs(sv) > b))).any())
+			{
+				// Box axes: the shape vertices relative to the center, projected on u and its normal.
+				V minU(1e30f), maxU(-1e30f), minV(1e30f), maxV(-1e30f);
+				for (int p = 0; p < shape.size; p++)
+				{
+					V dx = V(shape.points[p].x) - cx, dy = V(shape.points[p].y) - cy;
+					V pu = dx * ux + dy * uy;
+					V pv = dy * ux - dx * uy;
+					minU = vmin(minU, pu);
+					maxU = vmax(maxU, pu);
+					minV = vmin(minV, pv);
+					maxV = vmax(maxV, pv);
+				}
+				hit = hit & (minU <= a) & (maxU >= V(0) - a) & (minV <= b) & (maxV >= V(0) - b);
+
+				// Shape axes: the box is the interval of its center +- its projected radius.
+				for (int n = 0; n < shape.axes; n++)
+				{
+					V nx(shape.normals[n][0]), ny(shape.normals[n][1]);
+					V c = cx * nx + cy * ny;
+					V r = a * vabs(ux * nx + uy * ny) + b * vabs(ux * ny - uy * nx);
+					hit = hit & (c - r <= V(shape.maxProj[n])) & (c + r >= V(shape.minProj[n]));
+				}
+			}
+
+			select(hit, V(1), V(0)).store(overlap);
+			for (int l = 0; l < lanes; l++)
+				if (overlap[l] != 0)
+					hits[i + l] = 1;
+		}
+	}
+}
+
+#endif // COLLISIONBATCHKERNEL_H
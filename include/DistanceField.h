@@ -0,0 +1,46 @@
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include "ObstacleStore.h"
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+// Distance to the nearest obstacle over a grid of points, computed once for a map. Parking spots
+// count as obstacles whichever is the active target. Every cell keeps the exact distance at its
+// center less half a cell diagonal, so its value is a lower bound for any point within it.
+// Distances are capped at maxDistance and rounded down to a byte to keep the field in cache.
+class DistanceField
+{
+private:
+	float x_min;
+	float y_min;
+	float resolution;
+	float invResolution;
+	int cols;
+	int rows;
+	vector<unsigned char> cells;
+public:
+	static const int boxCircles = 4;
+	static constexpr float maxDistance = 5.0f;
+	static constexpr float quantum = maxDistance / 255;
+
+	DistanceField() : x_min(0), y_min(0), resolution(0), invResolution(0), cols(0), rows(0) {};
+
+	void build(const ObstacleStore& obstacles, const Rect2f& area, float resolution);
+	void clear();
+
+	inline bool isBuilt() const { return this->cols > 0; }
+	inline float getResolution() const { return this->resolution; }
+	// Lower bound of the distance from p to the nearest obstacle, 0 outside the field.
+	float distance(const Point2f& p) const;
+	// Lower bound of how far any point of a collision box can move without touching an obstacle,
+	// or a value <= 0 if it may touch one already. The box extends halfLength and halfWidth around
+	// a center centerOffset ahead of pos and is covered by boxCircles circles along its axis.
+	float boxClearance(const Point2f& pos, const Vec2f& ori, float centerOffset, float halfLength, float halfWidth) const;
+};
+
+#endif // DISTANCEFIELD_H
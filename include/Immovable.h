@@ -22,8 +22,6 @@ class Immovable : public MapObject
 {
 protected:
 	vector<Point2f> points;
-	Point2f centroid;
-	float range;
 
 	virtual void calculateCVPoints();
 public:
@@ -35,13 +33,9 @@ public:
 	};
 
 	Immovable(Map* map, const vector<float>& coords, int rowNum);
-	inline Point2f getCentroid() { return this->centroid; }
-	inline float getRange() { return this->range; }
 	virtual ~Immovable();
 
 	friend class Map;
-
-	virtual bool checkCollision(Point2f collZoneCorners[4]);
 };
 
 class Pillar : public Immovable
@@ -59,7 +53,6 @@ public:
 	Wall(Map* map, const vector<float>& coords);
 	virtual ~Wall() {};
 	virtual void draw() const;
-	bool checkCollision(Point2f collZoneCorners[4]);
 };
 
 class ParkingSpot : public Immovable
@@ -76,10 +69,9 @@ public:
 	inline Point2f getFinalOri() { return this->finalOri; }
 	inline const vector<CarConfiguration*> getPrePos() { return this->prePos; }
 
-	void activate() { this->activeTarget = true; }
-	void deactivate() { this->activeTarget = false; }
+	void activate();
+	void deactivate();
 	void setPreTargets();
-	bool checkCollision(Point2f collZoneCorners[4]);
 
 	ParkingSpot(Map* map, const vector<float>& coords);
 	virtual ~ParkingSpot();
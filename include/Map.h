@@ -5,6 +5,10 @@
 #include "Vehicle.h"
 #include "Blobstacle.h"
 #include "RamTree.h"
+#include "PlanObserver.h"
+#include "ObstacleStore.h"
+#include "CSpaceMap.h"
+#include "DistanceField.h"
 
 using namespace std;
 using namespace cv;
@@ -35,15 +39,29 @@ private:
 	const float vRearOverhang = 1.07f;
 
 	vector<Immovable*> objects;
+	ObstacleStore obstacles;
+	CSpaceMap cspace;
+	DistanceField distances;
 	vector<ParkingSpot*> pss;
 	Blobstacle* blob = 0;
 	Vehicle* vehicle;
 	RamTree* tree;
+	PlanObserver* observer;
+	PlannerSettings settings;
+	unsigned treeCount;
 
 	string windowName;
 
+	RamTree* newTree();
 	void createNewTree();
+	void buildCSpace();
+	void buildDistanceField();
 	void calculateCVPoints();
+	void acceptTrajectory();
+	bool finishPlanning(bool success);
+	PlanProgress getProgress(const PlanBudget& budget) const;
+	bool planPortfolio(const PlanBudget& budget);
+	bool planBidirectional(const PlanBudget& budget);
 public:
 	Mat map;
 
@@ -57,17 +75,27 @@ public:
 	inline float getYMin() const { return this->y_min; }
 	inline float getYMax() const { return this->y_max; }
 	inline const Vehicle& getVehicle() { return *(this->vehicle); }
+	inline void setObserver(PlanObserver* observer) { this->observer = observer; }
+	inline const PlannerSettings& getPlannerSettings() const { return this->settings; }
+	inline const DistanceField& getDistanceField() const { return this->distances; }
+	void setPlannerSettings(const PlannerSettings& settings);
 	virtual ~Map();
 	void draw();
 	void setBlob(Point2i center, int radius = 20);
 	void unsetBlob();
 
+	bool plan(const PlanRequest& request);
 	bool planTrajectory(int steps);
 	void reset();
 	void startStop();
 	void simulateStep();
 	bool checkCollision(const Point2f& pos, const Vec2f ori, float safety = -1);
+	int checkCollision(const Point2f* pos, const Vec2f* ori, int count, float safety = -1);
+	// Whether any of the boxes overlaps a solid obstacle.
+	bool checkBoxes(const BoxArrays& boxes);
 	void activateNextSpot(bool forward = true);
+	// Keeps the obstacle store in step with the target state of spot.
+	void updateSpot(ParkingSpot* spot);
 	Trajectory* composeTrajectoryFromTree();
 
 	bool addRRTNode();
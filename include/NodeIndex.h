@@ -0,0 +1,84 @@
+#ifndef NODEINDEX_H
+#define NODEINDEX_H
+
+#include <opencv2/core/mat.hpp>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "RSC.h"
+#include "RSCBatch.h"
+#include "RSCTable.h"
+#include "AppendArray.h"
+
+using namespace std;
+using namespace cv;
+
+class RamTreeNode;
+
+// Uniform (x, y, heading) grid over the tree nodes. Cells are visited in rings of growing
+// distance around the query, and exact RSC is only evaluated on nodes whose lower bound
+// (max of Euclidean distance and minTurnRadius * heading difference) can still beat the best.
+// With an RSCTable, candidates are ranked by their table length and its error bound tightens
+// the lower bound, so the nearest node tends to be measured first.
+// Inserts are lock-free: every cell is a prepend-only list. A query only considers the entries
+// published before it started, so concurrent inserts never give it a partial view.
+class NodeIndex
+{
+private:
+	struct Entry
+	{
+		RamTreeNode* node;
+		Point2f pos;
+		float heading;
+		float cosHeading;
+		float sinHeading;
+		int next;
+	};
+
+	struct Candidate
+	{
+		int entry;
+		float lowerBound;
+		float estimate;
+	};
+
+	static const int batchSize = 8;
+
+	float x_min;
+	float y_min;
+	float cellSize;
+	int cols;
+	int rows;
+	int headingBins;
+	float minTurnRadius;
+	const RSCTable* table;
+
+	AppendArray<Entry> entries;
+	unique_ptr<atomic<int>[]> heads;
+
+	int cellX(float x) const;
+	int cellY(float y) const;
+	int headingBin(float heading) const;
+	int cell(const Point2f& pos, float heading) const;
+	float cellDist(int ix, int iy, const Point2f& pos) const;
+	float binDist(int bin, float heading) const;
+	float tableLength(const Point2f& from, float fromHeading, float cosFrom, float sinFrom, const Point2f& to, float toHeading) const;
+	Candidate rank(int e, const Point2f& pos, float heading) const;
+public:
+	NodeIndex(float x_min, float x_max, float y_min, float y_max, float minTurnRadius, const RSCTable* table = 0, float cellSize = -1, int headingBins = 8);
+
+	static float lowerBound(const Point2f& from, float fromHeading, const Point2f& to, float toHeading, float minTurnRadius);
+
+	// Approximate RSC length used for ranking: the table length, or the lower bound without one.
+	float estimate(const Point2f& from, float fromHeading, const Point2f& to, float toHeading) const;
+
+	inline int size() const { return (int)this->entries.size(); }
+	void insert(RamTreeNode* node);
+	// Takes node out of its cell again. Unlike insert, it must not run alongside queries or inserts.
+	void remove(RamTreeNode* node);
+	NearestNode findNearest(const Point2f& pos, const Vec2f ori) const;
+	// Collects every node whose lower bound to (pos, ori) is below radius.
+	void findNear(const Point2f& pos, const Vec2f ori, float radius, vector<RamTreeNode*>& nodes) const;
+};
+
+#endif // NODEINDEX_H
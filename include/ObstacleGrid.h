@@ -0,0 +1,67 @@
+#ifndef OBSTACLEGRID_H
+#define OBSTACLEGRID_H
+
+#include <opencv2/core/mat.hpp>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+using namespace std;
+using namespace cv;
+
+// Uniform grid broadphase over the bounding boxes of the map objects, built once when the map
+// is loaded. Every object is listed in each cell its box touches. A query reports an object only
+// from the first cell shared by the query box and the object box, so each one is seen once
+// without any per-query bookkeeping, and concurrent queries are safe.
+class ObstacleGrid
+{
+private:
+	float x_min;
+	float y_min;
+	float cellSize;
+	int cols;
+	int rows;
+	// Objects of cell i are cellObjects[cellStart[i]] .. cellObjects[cellStart[i + 1] - 1].
+	vector<int> cellStart;
+	vector<int> cellObjects;
+	vector<Rect2f> bounds;
+
+	inline int cellX(float x) const { return min(max((int)floor((x - this->x_min) / this->cellSize), 0), this->cols - 1); }
+	inline int cellY(float y) const { return min(max((int)floor((y - this->y_min) / this->cellSize), 0), this->rows - 1); }
+public:
+	ObstacleGrid() : x_min(0), y_min(0), cellSize(1), cols(0), rows(0) {};
+
+	void build(const vector<Rect2f>& bounds, float cellSize);
+
+	// Calls visit with the index of every object whose bounding box overlaps box, until it
+	// returns true. Returns whether any call did.
+	template<class Visitor>
+	bool any(const Rect2f& box, Visitor visit) const
+	{
+		if (!this->cols)
+			return false;
+		int x0 = this->cellX(box.x), x1 = this->cellX(box.x + box.width);
+		int y0 = this->cellY(box.y), y1 = this->cellY(box.y + box.height);
+		for (int iy = y0; iy <= y1; iy++)
+		{
+			for (int ix = x0; ix <= x1; ix++)
+			{
+				int cell = iy * this->cols + ix;
+				for (int i = this->cellStart[cell]; i < this->cellStart[cell + 1]; i++)
+				{
+					int object = this->cellObjects[i];
+					const Rect2f& b = this->bounds[object];
+					if (max(this->cellX(b.x), x0) != ix || max(this->cellY(b.y), y0) != iy)
+						continue;
+					if (b.x > box.x + box.width || b.x + b.width < box.x || b.y > box.y + box.height || b.y + b.height < box.y)
+						continue;
+					if (visit(object))
+						return true;
+				}
+			}
+		}
+		return false;
+	}
+};
+
+#endif // OBSTACLEGRID_H
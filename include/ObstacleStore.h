@@ -0,0 +1,58 @@
+#ifndef OBSTACLESTORE_H
+#define OBSTACLESTORE_H
+
+#include "ObstacleGrid.h"
+#include "CollisionBatch.h"
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+// The map obstacles compiled into contiguous arrays by kind when the map is loaded: pillar quads,
+// wall segments and parking spot quads, all in separating axis form. A concave quad is stored as
+// the two triangles on either side of the diagonal through its reflex vertex. Spots are masked by
+// a solid flag that follows their active target state. The grid indexes the shapes themselves, so
+// the narrow phase never touches the map objects.
+class ObstacleStore
+{
+private:
+	vector<ConvexShape> quads;
+	vector<ConvexShape> segments;
+	vector<ConvexShape> spots;
+	// Spot of every shape in spots, as numbered by addSpot.
+	vector<int> spotOwners;
+	vector<char> solidSpots;
+	ObstacleGrid grid;
+
+	static void addPolygon(const Point2f* points, int size, vector<ConvexShape>& shapes);
+	static float pointDistance(const ConvexShape& shape, const Point2f& p);
+public:
+	ObstacleStore() {};
+
+	void addQuad(const Point2f* points, int size);
+	void addSegment(const Point2f& a, const Point2f& b);
+	// Returns the number of the spot, counting from 0. Spots start out solid.
+	int addSpot(const Point2f* points, int size);
+	// Indexes everything added so far.
+	void build(float cellSize);
+
+	inline void setSpotSolid(int spot, bool solid) { this->solidSpots[spot] = solid; }
+
+	// Axis aligned box around all boxes, for the bounds of the queries below.
+	static Rect2f boxBounds(const BoxArrays& boxes);
+
+	// Marks in hits the first count boxes that overlap a solid obstacle within bounds, the box
+	// around all of them, and returns the index of the first one, or -1. Shapes are only tested
+	// against boxes before the first hit found so far.
+	int collide(const BoxArrays& boxes, const Rect2f& bounds, unsigned char* hits) const;
+	// Marks in hits every box that overlaps an obstacle within bounds. Spots count as solid with
+	// spots set and are skipped otherwise, whatever their flags.
+	void collideAll(const BoxArrays& boxes, const Rect2f& bounds, unsigned char* hits, bool spots) const;
+	// Distance from p to the nearest obstacle, spots included whatever their flags, or maxDistance
+	// if there is none that close.
+	float distance(const Point2f& p, float maxDistance) const;
+};
+
+#endif // OBSTACLESTORE_H
@@ -0,0 +1,20 @@
+#ifndef PLANOBSERVER_H
+#define PLANOBSERVER_H
+
+#include "PlanRequest.h"
+
+class Map;
+
+// Optional hook into Map::planTrajectory, used for rendering and user input.
+// Without an observer the planner runs without any window or event polling.
+class PlanObserver
+{
+public:
+	// Called before every RRT iteration. Returning false stops the planning like a cancellation.
+	virtual bool onPlanStep(Map& map, const PlanProgress& progress) = 0;
+	virtual void onPlanFinished(Map& /*map*/, bool /*success*/) {};
+
+	virtual ~PlanObserver() {};
+};
+
+#endif // PLANOBSERVER_H
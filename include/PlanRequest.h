@@ -0,0 +1,63 @@
+#ifndef PLANREQUEST_H
+#define PLANREQUEST_H
+
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+// Lets another thread stop a running Map::plan call. The best trajectory found so far is kept.
+class CancellationToken
+{
+private:
+	atomic<bool> cancelled;
+public:
+	CancellationToken() : cancelled(false) {};
+
+	inline void cancel() { this->cancelled.store(true, memory_order_relaxed); }
+	inline void reset() { this->cancelled.store(false, memory_order_relaxed); }
+	inline bool isCancelled() const { return this->cancelled.load(memory_order_relaxed); }
+};
+
+// Stop conditions for Map::plan. Limits left negative are not enforced.
+struct PlanRequest
+{
+	// Wall-clock budget in milliseconds.
+	double budget = -1;
+	// Maximum number of RRT iterations, counted per thread.
+	int steps = -1;
+	CancellationToken* token = 0;
+};
+
+// Reported to the PlanObserver before every iteration.
+struct PlanProgress
+{
+	int nodes;
+	// Length of the best path in the tree so far, infinity while there is none.
+	float bestCost;
+	// Milliseconds since planning started.
+	double elapsed;
+};
+
+// Tracks a PlanRequest from the moment planning starts. Safe to query from several threads.
+class PlanBudget
+{
+private:
+	const PlanRequest& request;
+	chrono::steady_clock::time_point start;
+public:
+	PlanBudget(const PlanRequest& request) : request(request), start(chrono::steady_clock::now()) {};
+
+	inline double elapsed() const { return chrono::duration<double, milli>(chrono::steady_clock::now() - this->start).count(); }
+
+	inline bool exhausted(int step) const
+	{
+		if (this->request.steps >= 0 && step >= this->request.steps)
+			return true;
+		if (this->request.token && this->request.token->isCancelled())
+			return true;
+		return this->request.budget >= 0 && this->elapsed() >= this->request.budget;
+	}
+};
+
+#endif // PLANREQUEST_H
@@ -0,0 +1,48 @@
+#ifndef PLANNERSETTINGS_H
+#define PLANNERSETTINGS_H
+
+#include "Sampler.h"
+
+class RSCTable;
+
+struct PlannerSettings
+{
+	Sampler::Strategy sampler = Sampler::UNIFORM;
+	float goalBias = 0.1f;
+	// Every new tree is seeded with seed + the number of trees created before it.
+	unsigned seed = 0;
+	// Number of independent trees grown in parallel, one per thread. The first to reach the target wins.
+	int portfolioSize = 1;
+	// Number of threads growing a single tree together. Only used without a portfolio.
+	int growthThreads = 1;
+	// RRT*: choose the cheapest near parent, rewire neighbours and keep improving the path
+	// until the step budget is spent. Runs on the calling thread only.
+	bool optimize = false;
+	// Scales the neighbourhood searched for parents and rewiring.
+	float rewireGamma = 30.0f;
+	// RRT-Connect: a second tree grows from the pre-targets of the parking spot and both trees
+	// try to join each other. Runs on the calling thread and stops at the first connection.
+	bool bidirectional = false;
+	// Precomputed RSC lengths used to rank nearest node candidates. Not owned, may be shared by
+	// several trees.
+	const RSCTable* rscTable = 0;
+	// Cell size of the configuration space occupancy map that answers most collision checks, or 0
+	// to check every pose exactly. The map is built when the settings are applied and kept as long
+	// as its resolution and heading bins stay the same.
+	float cspaceResolution = 0;
+	int cspaceHeadingBins = 64;
+	// Cell size of the obstacle distance field that lets edge validation skip the steps the
+	// clearance of a pose already proves free, or 0 to check every step. Built and kept like the
+	// configuration space map.
+	float distanceFieldResolution = 0;
+	// Lazy RRT: new edges are only checked at their end pose, and the edges of a path are stepped
+	// through once it reaches the target. An invalid edge is cut off with its subtree and the
+	// search goes on. Needs the tree to itself, so it is ignored with optimize, bidirectional and
+	// growth threads.
+	bool lazy = false;
+	// Each node remembers the last few extensions from it that hit an obstacle, by the pose they
+	// end in relative to the node, and drops later ones that would end in the same cell.
+	bool failureMemo = false;
+};
+
+#endif // PLANNERSETTINGS_H
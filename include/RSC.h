@@ -2,6 +2,7 @@
 #define RSC_H
 
 #include <vector>
+#include <limits>
 #include <opencv2/core/mat.hpp>
 
 using namespace std;
@@ -18,31 +19,33 @@ struct PathElem
 	int isForward = 1;
 };
 
+// Reeds-Shepp path with inline storage and its length. No word has more than 5 segments,
+// so steering never touches the heap.
+struct RSCPath
+{
+	PathElem elems[5];
+	int count = 0;
+	float length = 0;
+
+	inline int size() const { return this->count; }
+	inline const PathElem* begin() const { return this->elems; }
+	inline const PathElem* end() const { return this->elems + this->count; }
+	inline void push_back(const PathElem& elem)
+	{
+		this->elems[this->count++] = elem;
+		this->length += elem.length;
+	}
+};
+
 struct NearestNode
 {
 	RamTreeNode* node;
-	vector<PathElem> path;
-	float totalLenght;
+	RSCPath path;
 };
 
-float sumRSCPath(const vector<PathElem>& rsc);
-bool rscComp(const vector<PathElem>& rsc1, const vector<PathElem>& rsc2);
-vector<PathElem> rscMin(const vector<vector<PathElem>>& paths);
-
-void reverse(vector<PathElem>& pathElems);
-void mirror(vector<PathElem>& pathElems);
-
-vector<PathElem> planPath1(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath2(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath3(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath4(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath5(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath6(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath7(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath8(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath9(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath10(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath11(Point2f targetPos, float phi, float rMin);
-vector<PathElem> planPath12(Point2f targetPos, float phi, float rMin);
+// Shortest Reeds-Shepp path over all 48 words, to targetPos and heading phi given relative to
+// a start at the origin heading along x. Words that cannot be shorter than upperBound are
+// skipped, and the path is empty if none is.
+RSCPath planShortestPath(const Point2f& targetPos, float phi, float rMin, float upperBound = numeric_limits<float>::infinity());
 
 #endif RSC_H
\ No newline at end of file
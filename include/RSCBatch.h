@@ -0,0 +1,56 @@
+#ifndef RSCBATCH_H
+#define RSCBATCH_H
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+// Node poses in structure-of-arrays layout, so that the batch kernels can load one field of
+// several nodes with a single instruction.
+struct PoseBatch
+{
+	vector<float> x;
+	vector<float> y;
+	vector<float> heading;
+	vector<float> cosHeading;
+	vector<float> sinHeading;
+
+	void clear();
+	void push_back(const Point2f& pos, float heading);
+	inline int size() const { return (int)this->x.size(); }
+};
+
+// Raw view of a PoseBatch range handed to the instruction set specific kernels.
+struct PoseArrays
+{
+	const float* x;
+	const float* y;
+	const float* heading;
+	const float* cosHeading;
+	const float* sinHeading;
+	int count;
+};
+
+// Reeds-Shepp lengths from count poses starting at first to (pos, heading). Returns the index of
+// the shortest one, or -1 if none is reachable, and stores its length. Uses AVX2 or SSE when the
+// CPU has them, so lengths may differ from planShortestPath in the last digits.
+int rscBatchArgmin(const PoseBatch& poses, int first, int count, const Point2f& pos, float heading, float rMin, float& length);
+
+namespace rscbatch_scalar
+{
+	int argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length);
+}
+
+namespace rscbatch_sse
+{
+	int argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length);
+}
+
+namespace rscbatch_avx2
+{
+	int argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length);
+}
+
+#endif // RSCBATCH_H
@@ -0,0 +1,265 @@
+#ifndef RSCBATCHKERNEL_H
+#define RSCBATCHKERNEL_H
+
+#include "RSCBatch.h"
+
+// Reeds-Shepp length kernel shared by the instruction set specific translation units. V is a
+// SIMD float wrapper with arithmetic operators, comparisons returning V::Mask and the free
+// functions select, vsqrt, vabs, vmin, vmax and vround. Everything lives in an unnamed namespace,
+// so each file instantiates it for its own instruction set, see SimdFloat.h.
+namespace
+{
+	const float KERNEL_ZERO = 1e-5f;
+	const float KERNEL_PI = 3.14159265358979f;
+	const float KERNEL_HALF_PI = 1.57079632679490f;
+	const float KERNEL_2PI = 6.28318530717959f;
+	const float KERNEL_INF = 3.0e38f;
+
+	template<class V> inline V reduceAngleV(const V& x)
+	{
+		return x - V(KERNEL_2PI) * vround(x * V(1 / KERNEL_2PI));
+	}
+
+	// Cephes atanf on [0, 1].
+	template<class V> inline V atanUnitV(const V& x)
+	{
+		typename V::Mask big = x > V(0.4142135623730950f);
+		V y = select(big, V(KERNEL_PI / 4), V(0));
+		V z = select(big, (x - V(1)) / (x + V(1)), x);
+		V zz = z * z;
+		return y + (((V(8.05374449538e-2f) * zz - V(1.38776856032e-1f)) * zz + V(1.99777106478e-1f)) * zz - V(3.33329491539e-1f)) * zz * z + z;
+	}
+
+	template<class V> inline V atan2V(const V& y, const V& x)
+	{
+		V ax = vabs(x), ay = vabs(y);
+		V num = vmin(ax, ay), den = vmax(ax, ay);
+		V r = atanUnitV(select(den > V(0), num / vmax(den, V(1e-30f)), V(0)));
+		r = select(ay > ax, V(KERNEL_HALF_PI) - r, r);
+		r = select(x < V(0), V(KERNEL_PI) - r, r);
+		return select(y < V(0), V(0) - r, r);
+	}
+
+	// Cephes sinf/cosf with a three part reduction by pi / 2.
+	template<class V> inline void sinCosV(const V& x, V& s, V& c)
+	{
+		V j = vround(x * V(2 / KERNEL_PI));
+		V r = ((x - j * V(1.5703125f)) - j * V(4.837512969970703125e-4f)) - j * V(7.54978995489188216e-8f);
+		V rr = r * r;
+		V sr = r + r * rr * ((V(-1.9515295891e-4f) * rr + V(8.3321608736e-3f)) * rr - V(1.6666654611e-1f));
+		V cr = V(1) - V(0.5f) * rr + rr * rr * ((V(2.443315711809948e-5f) * rr - V(1.388731625493765e-3f)) * rr + V(4.166664568298827e-2f));
+		// Quadrant q = j mod 4, computed in floats to stay within the wrapper interface.
+		V q = j - V(4) * vround((j - V(1.5f)) * V(0.25f));
+		typename V::Mask swap = ((q > V(0.5f)) & (q < V(1.5f))) | (q > V(2.5f));
+		V sinBase = select(swap, cr, sr);
+		V cosBase = select(swap, sr, cr);
+		s = select(q > V(1.5f), V(0) - sinBase, sinBase);
+		c = select((q > V(0.5f)) & (q < V(2.5f)), V(0) - cosBase, cosBase);
+	}
+
+	// Cephes asinf, the argument has to be in [-1, 1].
+	template<class V> inline V asinV(const V& x)
+	{
+		V a = vabs(x);
+		typename V::Mask big = a > V(0.5f);
+		V z = select(big, V(0.5f) * (V(1) - a), a * a);
+		V w = select(big, vsqrt(z), a);
+		V p = ((((V(4.2163199048e-2f) * z + V(2.4181311049e-2f)) * z + V(4.5470025998e-2f)) * z + V(7.4953002686e-2f)) * z + V(1.6666752422e-1f)) * z * w + w;
+		p = select(big, V(KERNEL_HALF_PI) - V(2) * p, p);
+		return select(x < V(0), V(0) - p, p);
+	}
+
+	template<class V> inline V acosV(const V& x)
+	{
+		return V(KERNEL_HALF_PI) - asinV(x);
+	}
+
+	template<class V> inline void considerV(V& best, const typename V::Mask& valid, const V& length)
+	{
+		best = vmin(best, select(valid, length, V(KERNEL_INF)));
+	}
+
+	template<class V> inline void LpSpLpV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V a = x - s, b = y - V(1) + c;
+		V u = vsqrt(a * a + b * b);
+		V t = atan2V(b, a);
+		V v = reduceAngleV(phi - t);
+		considerV(best, (t >= V(-KERNEL_ZERO)) & (v >= V(-KERNEL_ZERO)), vabs(t) + u + vabs(v));
+	}
+
+	template<class V> inline void LpSpRpV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V a = x + s, b = y - V(1) - c;
+		V u1 = a * a + b * b;
+		V u = vsqrt(vmax(u1 - V(4), V(0)));
+		V t = reduceAngleV(atan2V(b, a) + atan2V(V(2), u));
+		V v = reduceAngleV(t - phi);
+		considerV(best, (u1 >= V(4)) & (t >= V(-KERNEL_ZERO)) & (v >= V(-KERNEL_ZERO)), vabs(t) + u + vabs(v));
+	}
+
+	template<class V> inline void LpRmLV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V a = x - s, b = y - V(1) + c;
+		V u1 = vsqrt(a * a + b * b);
+		V u = V(-2) * asinV(vmin(V(0.25f) * u1, V(1)));
+		V t = reduceAngleV(atan2V(b, a) + V(0.5f) * u + V(KERNEL_PI));
+		V v = reduceAngleV(phi - t + u);
+		considerV(best, (u1 <= V(4)) & (t >= V(-KERNEL_ZERO)) & (u <= V(KERNEL_ZERO)), vabs(t) + vabs(u) + vabs(v));
+	}
+
+	template<class V> inline void tauOmegaV(const V& u, const V& v, const V& xi, const V& eta, const V& phi, V& tau, V& omega)
+	{
+		V delta = reduceAngleV(u - v);
+		V su, cu, sd, cd, sv, cv;
+		sinCosV(u, su, cu);
+		sinCosV(delta, sd, cd);
+		sinCosV(v, sv, cv);
+		V A = su - sd;
+		V B = cu - cd - V(1);
+		V t1 = atan2V(eta * A - xi * B, xi * A + eta * B);
+		V t2 = V(2) * (cd - cv - cu) + V(3);
+		tau = reduceAngleV(t1 + select(t2 < V(0), V(KERNEL_PI), V(0)));
+		omega = reduceAngleV(tau - u + v - phi);
+	}
+
+	template<class V> inline void LpRupLumRmV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V xi = x + s, eta = y - V(1) - c;
+		V rho = V(0.25f) * (V(2) + vsqrt(xi * xi + eta * eta));
+		V u = acosV(vmin(rho, V(1)));
+		V t, v;
+		tauOmegaV(u, V(0) - u, xi, eta, phi, t, v);
+		considerV(best, (rho <= V(1)) & (t >= V(-KERNEL_ZERO)) & (v <= V(KERNEL_ZERO)), vabs(t) + V(2) * vabs(u) + vabs(v));
+	}
+
+	template<class V> inline void LpRumLumRpV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V xi = x + s, eta = y - V(1) - c;
+		V rho = (V(20) - xi * xi - eta * eta) * V(1.0f / 16);
+		V u = V(0) - acosV(vmax(vmin(rho, V(1)), V(0)));
+		V t, v;
+		tauOmegaV(u, u, xi, eta, phi, t, v);
+		considerV(best, (rho >= V(0)) & (rho <= V(1)) & (u >= V(-KERNEL_HALF_PI)) & (t >= V(-KERNEL_ZERO)) & (v >= V(-KERNEL_ZERO)), vabs(t) + V(2) * vabs(u) + vabs(v));
+	}
+
+	template<class V> inline void LpRmSmLmV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V a = x - s, b = y - V(1) + c;
+		V rho = vsqrt(a * a + b * b);
+		V r = vsqrt(vmax(rho * rho - V(4), V(0)));
+		V u = V(2) - r;
+		V t = reduceAngleV(atan2V(b, a) + atan2V(r, V(-2)));
+		V v = reduceAngleV(phi - V(KERNEL_HALF_PI) - t);
+		considerV(best, (rho >= V(2)) & (t >= V(-KERNEL_ZERO)) & (u <= V(KERNEL_ZERO)) & (v <= V(KERNEL_ZERO)), vabs(t) + V(KERNEL_HALF_PI) + vabs(u) + vabs(v));
+	}
+
+	template<class V> inline void LpRmSmRmV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V xi = x + s, eta = y - V(1) - c;
+		V rho = vsqrt(xi * xi + eta * eta);
+		V t = atan2V(xi, V(0) - eta);
+		V u = V(2) - rho;
+		V v = reduceAngleV(t + V(KERNEL_HALF_PI) - phi);
+		considerV(best, (rho >= V(2)) & (t >= V(-KERNEL_ZERO)) & (u <= V(KERNEL_ZERO)) & (v <= V(KERNEL_ZERO)), vabs(t) + V(KERNEL_HALF_PI) + vabs(u) + vabs(v));
+	}
+
+	template<class V> inline void LpRmSLmRpV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		V xi = x + s, eta = y - V(1) - c;
+		V rho = vsqrt(xi * xi + eta * eta);
+		V u = V(4) - vsqrt(vmax(rho * rho - V(4), V(0)));
+		V t = reduceAngleV(atan2V((V(4) - u) * xi - V(2) * eta, V(-2) * xi + (u - V(4)) * eta));
+		V v = reduceAngleV(t - phi);
+		considerV(best, (rho >= V(2)) & (u <= V(KERNEL_ZERO)) & (t >= V(-KERNEL_ZERO)) & (v >= V(-KERNEL_ZERO)), vabs(t) + V(KERNEL_PI) + vabs(u) + vabs(v));
+	}
+
+	// Applies a base formula to the query, its timeflip, its reflection and both.
+	template<class V, void (*F)(const V&, const V&, const V&, const V&, const V&, V&)> inline void symmetricV(const V& x, const V& y, const V& phi, const V& s, const V& c, V& best)
+	{
+		F(x, y, phi, s, c, best);
+		F(V(0) - x, y, V(0) - phi, V(0) - s, c, best);
+		F(x, V(0) - y, V(0) - phi, V(0) - s, c, best);
+		F(V(0) - x, V(0) - y, phi, s, c, best);
+	}
+
+	// Length of the shortest word for every lane, matching planShortestPath.
+	template<class V> inline V shortestLengthV(const V& x, const V& y, const V& phi, const V& s, const V& c)
+	{
+		V best(KERNEL_INF);
+		V xb = x * c + y * s, yb = x * s - y * c;
+		symmetricV<V, LpSpLpV<V> >(x, y, phi, s, c, best);
+		symmetricV<V, LpSpRpV<V> >(x, y, phi, s, c, best);
+		symmetricV<V, LpRmLV<V> >(x, y, phi, s, c, best);
+		symmetricV<V, LpRmLV<V> >(xb, yb, phi, s, c, best);
+		symmetricV<V, LpRupLumRmV<V> >(x, y, phi, s, c, best);
+		symmetricV<V, LpRumLumRpV<V> >(x, y, phi, s, c, best);
+		symmetricV<V, LpRmSmLmV<V> >(x, y, phi, s, c, best);
+		symmetricV<V, LpRmSmRmV<V> >(x, y, phi, s, c, best);
+		symmetricV<V, LpRmSmLmV<V> >(xb, yb, phi, s, c, best);
+		symmetricV<V, LpRmSmRmV<V> >(xb, yb, phi, s, c, best);
+		symmetricV<V, LpRmSLmRpV<V> >(x, y, phi, s, c, best);
+		return best;
+	}
+
+	template<class V> inline int batchArgmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length)
+	{
+		const int width = V::width;
+		float sinTarget = sin(heading), cosTarget = cos(heading);
+		float lengths[width];
+		float tailX[width], tailY[width], tailHeading[width], tailCos[width], tailSin[width];
+		int bestIndex = -1;
+		float bestLength = KERNEL_INF;
+		for (int i = 0; i < poses.count; i += width)
+		{
+			int lanes = poses.count - i < width ? poses.count - i : width;
+			V nx, ny, nh, nc, ns;
+			if (lanes == width)
+			{
+				nx = V::load(poses.x + i);
+				ny = V::load(poses.y + i);
+				nh = V::load(poses.heading + i);
+				nc = V::load(poses.cosHeading + i);
+				ns = V::load(poses.sinHeading + i);
+			}
+			else
+			{
+				for (int l = 0; l < width; l++)
+				{
+					int k = i + (l < lanes ? l : 0);
+					tailX[l] = poses.x[k];
+					tailY[l] = poses.y[k];
+					tailHeading[l] = poses.heading[k];
+					tailCos[l] = poses.cosHeading[k];
+					tailSin[l] = poses.sinHeading[k];
+				}
+				nx = V::load(tailX);
+				ny = V::load(tailY);
+				nh = V::load(tailHeading);
+				nc = V::load(tailCos);
+				ns = V::load(tailSin);
+			}
+			// Target in each node's frame, scaled to the unit turning circle.
+			V dx = V(x) - nx, dy = V(y) - ny;
+			V inv(1 / rMin);
+			V lx = (dx * nc + dy * ns) * inv;
+			V ly = (dy * nc - dx * ns) * inv;
+			V phi = reduceAngleV(V(heading) - nh);
+			V s = V(sinTarget) * nc - V(cosTarget) * ns;
+			V c = V(cosTarget) * nc + V(sinTarget) * ns;
+			shortestLengthV(lx, ly, phi, s, c).store(lengths);
+			for (int l = 0; l < lanes; l++)
+			{
+				if (lengths[l] < bestLength)
+				{
+					bestLength = lengths[l];
+					bestIndex = i + l;
+				}
+			}
+		}
+		length = bestLength * rMin;
+		return bestLength < KERNEL_INF ? bestIndex : -1;
+	}
+}
+
+#endif // RSCBATCHKERNEL_H
@@ -0,0 +1,51 @@
+#ifndef RSCTABLE_H
+#define RSCTABLE_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Precomputed Reeds-Shepp lengths for minTurnRadius 1 over a grid of relative poses (x, y, phi).
+// The length is unchanged by mirroring y or by driving the path backwards, so only x, y >= 0 is
+// stored. Lookups interpolate trilinearly; every grid value is within the length of one cell
+// diagonal step of the exact length (triangle inequality), so errorBound also bounds the error
+// of an interpolated value. The file is memory mapped where the platform allows it.
+class RSCTable
+{
+private:
+	struct Header
+	{
+		char magic[8];
+		int cols;
+		int headingBins;
+		float extent;
+		float errorBound;
+	};
+
+	const Header* header;
+	const float* values;
+	float step;
+	float binWidth;
+	void* mapping;
+	size_t mappingSize;
+	vector<char> buffer;
+
+	void release();
+	RSCTable(const RSCTable&) = delete;
+	RSCTable& operator=(const RSCTable&) = delete;
+public:
+	explicit RSCTable(const string& file);
+	virtual ~RSCTable();
+
+	// Writes a table covering |x|, |y| <= extent with cols samples per axis.
+	static void generate(const string& file, float extent = 4, int cols = 81, int headingBins = 32);
+
+	inline float getExtent() const { return this->header->extent; }
+	inline float getErrorBound() const { return this->header->errorBound; }
+	// Approximate length to (x, y, phi) relative to a start at the origin heading along x, or a
+	// negative value if the pose lies outside the table.
+	float lookup(float x, float y, float phi) const;
+};
+
+#endif // RSCTABLE_H
@@ -2,10 +2,15 @@
 #define RAMTREE_H
 
 #include <opencv2/core/mat.hpp>
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include "Trajectory.h"
 #include "RSC.h"
 #include "Immovable.h"
+#include "NodeIndex.h"
+#include "PlannerSettings.h"
+#include "PlanRequest.h"
 
 using namespace std;
 using namespace cv;
@@ -21,15 +26,28 @@ private:
 	Point2f pos;
 	Vec2f ori;
 
-	vector<Segment*> segments;
+	int firstEdge;
+	int edgeCount;
 	float dist;
 
 	float rootDist;
-
-	void setSegments(const AbstractTrajectory& traj);
+	// Whether the edge from the parent has been stepped through. Only lazy trees add nodes without.
+	bool validated;
+	// Keys of the last extensions from this node that ran into an obstacle, most recent at
+	// failures % failureMemoSize, 0 where unused. Threads growing the tree share them unlocked.
+	static const int failureMemoSize = 4;
+	atomic<unsigned> failedEdges[failureMemoSize];
+	atomic<int> failures;
+
+	void setEdges(const AbstractTrajectory& traj);
+	void setParent(RamTreeNode* parent, const AbstractTrajectory& traj);
+	void updateRootDist();
+	void clearFailures();
+	// Quantised pose of the end of an edge from this node, relative to the node.
+	unsigned edgeKey(const Point2f& pos, const Vec2f& ori) const;
+	bool hasFailed(unsigned key) const;
+	void addFailure(unsigned key);
 public:
-	static vector< vector<PathElem>(*)(Point2f, float, float) > plans;
-
 	RamTreeNode* parent;
 	vector<RamTreeNode*> childs;
 
@@ -41,9 +59,11 @@ public:
 	inline Vec2f getOri() const { return this->ori; };
 	inline float getRootDist() const { return this->rootDist; };
 	
-	vector<PathElem> calculateDist(const Point2f& pos, const Vec2f ori);
+	// Shortest RSC to (pos, ori), or an empty path if none is shorter than upperBound.
+	RSCPath calculateDist(const Point2f& pos, const Vec2f ori, float upperBound = numeric_limits<float>::infinity());
 	float calculateEucledeanDist(const Point2f& pos);
 	void addChild(RamTreeNode* child);
+	void removeChild(RamTreeNode* child);
 	void draw();
 
 	friend class RamTree;
@@ -53,32 +73,65 @@ class RamTree
 {
 private:
 	float targetProximity;
-	bool targetReached;
+	atomic<bool> targetReached;
+	mutex targetMutex;
+	mutex childMutex;
 	float increment;
 	float minTurnRadius;
+	// Goal trees grow from the parking spot. Their edges lead from each node to its parent.
+	bool reversed;
+	bool lazy;
 
 
-	vector<RamTreeNode*> vertices;
+	AppendArray<RamTreeNode*> vertices;
+	AppendArray<EdgeRecord> edges;
+	NodeIndex index;
+	PlannerSettings settings;
+	Sampler* sampler;
 	RamTreeNode* targetNode;
 	bool checkTarget(RamTreeNode* node);
-	AbstractTrajectory* truncatePath(NearestNode& nearestNode, float truncLength, bool& truncated, float stepSize = 0.1);
+	bool validatePath();
+	void discard(RamTreeNode* node);
+	float nearRadius() const;
+	AbstractTrajectory* chooseParent(NearestNode& nearestNode, AbstractTrajectory* traj, const vector<RamTreeNode*>& near);
+	void rewire(RamTreeNode* node, const vector<RamTreeNode*>& near);
+	RamTreeNode* attachNode(RamTreeNode* parent, const AbstractTrajectory& traj);
+	bool graft(RamTreeNode* node, const AbstractTrajectory& bridge, const RamTree* goal, const RamTreeNode* goalNode);
+	AbstractTrajectory* reversePath(const AbstractTrajectory& traj) const;
+	AbstractTrajectory* truncatePath(NearestNode& nearestNode, float truncLength, bool& truncated, float stepSize = 0.1, bool useChunk = false);
 public:
 	vector<CarConfiguration*> targets;
 
 	Map* map;
 
-	RamTree(Map* map, const Point2f& pos, const Vec2f ori, const vector<CarConfiguration*>& targets, float minTurnRadius = 3, float increment = 3, float targetProximity = 8);
+	RamTree(Map* map, const Point2f& pos, const Vec2f ori, const vector<CarConfiguration*>& targets, const PlannerSettings& settings, float minTurnRadius = 3, float increment = 3, float targetProximity = 8);
+	RamTree(Map* map, const vector<CarConfiguration*>& preTargets, const PlannerSettings& settings, float minTurnRadius = 3, float increment = 3);
 
 	NearestNode findNearestNode(const Point2f& pos, const Vec2f ori);
 	inline float getMinTurnRadius() { return this->minTurnRadius; }
+	inline bool isTargetReached() const { return this->targetReached; }
+	inline int getNodeCount() const { return (int)this->vertices.size(); }
+	float getBestCost() const;
+	template<class T> void appendEdges(const RamTreeNode* node, T& traj) const;
 	bool addNode(NearestNode& nearestNode, float truncLength, bool& truncated, RamTreeNode*& newNode, bool isTarget = false);
 	RamTreeNode* addFixNode(RamTreeNode* nearestNode, AbstractTrajectory* t);
 	void draw();
 	bool addRRTNode();
+	bool addRRTNode(Sampler* sampler);
+	bool addConnectNode(RamTree* goal, bool growGoal);
 	void growRRT(int steps);
+	bool growConcurrent(int threads, const PlanBudget& budget);
 	Trajectory* composeTrajectoryFromTree();
 	virtual ~RamTree();
+
+	friend class RamTreeNode;
 };
 
+template<class T> void RamTree::appendEdges(const RamTreeNode* node, T& traj) const
+{
+	for (int i = node->firstEdge; i < node->firstEdge + node->edgeCount; i++)
+		traj.addRecord(this->edges[i], this->minTurnRadius);
+}
+
 #endif // RAMTREE_H
 
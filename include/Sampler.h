@@ -0,0 +1,81 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <opencv2/core/mat.hpp>
+#include <random>
+#include <vector>
+#include "Immovable.h"
+
+using namespace std;
+using namespace cv;
+
+class Sampler
+{
+protected:
+	float x_min;
+	float x_max;
+	float y_min;
+	float y_max;
+
+public:
+	enum Strategy
+	{
+		UNIFORM,
+		GOAL_BIASED,
+		HALTON,
+	};
+
+	Sampler(float x_min, float x_max, float y_min, float y_max);
+
+	static Sampler* create(Strategy strategy, unsigned seed, float x_min, float x_max, float y_min, float y_max, const vector<CarConfiguration*>& targets, float goalBias);
+
+	virtual void sample(Point2f& pos, Vec2f& ori) = 0;
+
+	virtual ~Sampler() {};
+};
+
+class UniformSampler : public Sampler
+{
+protected:
+	mt19937 generator;
+	uniform_real_distribution<float> distributionX;
+	uniform_real_distribution<float> distributionY;
+	uniform_real_distribution<float> distributionPhi;
+
+public:
+	UniformSampler(unsigned seed, float x_min, float x_max, float y_min, float y_max);
+
+	virtual void sample(Point2f& pos, Vec2f& ori);
+};
+
+// Returns one of the targets with probability goalBias, a uniform sample otherwise.
+// The targets are referenced, not copied, so the owner can retarget the sampler.
+class GoalBiasedSampler : public UniformSampler
+{
+private:
+	const vector<CarConfiguration*>& targets;
+	float goalBias;
+	uniform_real_distribution<float> distributionBias;
+
+public:
+	GoalBiasedSampler(unsigned seed, float x_min, float x_max, float y_min, float y_max, const vector<CarConfiguration*>& targets, float goalBias);
+
+	virtual void sample(Point2f& pos, Vec2f& ori);
+};
+
+// Halton sequence over (x, y, phi) in bases 2, 3 and 5. The seed selects a random
+// Cranley-Patterson rotation, so different seeds give different, equally even sequences.
+class HaltonSampler : public Sampler
+{
+private:
+	unsigned index;
+	double offset[3];
+
+	static double radicalInverse(unsigned index, unsigned base);
+public:
+	HaltonSampler(unsigned seed, float x_min, float x_max, float y_min, float y_max);
+
+	virtual void sample(Point2f& pos, Vec2f& ori);
+};
+
+#endif // SAMPLER_H
@@ -0,0 +1,130 @@
+#ifndef SIMDFLOAT_H
+#define SIMDFLOAT_H
+
+// Float vector wrappers shared by the batch kernels. They live in an unnamed namespace, so every
+// translation unit keeps its own copies.
+//
+// No file is built for AVX2 as a whole. The AVX2 wrappers, and the kernels a file instantiates for
+// them, are compiled for AVX2 between SIMD_AVX2_BEGIN and SIMD_AVX2_END only. Every header with
+// inline functions of its own has to be included before SIMD_AVX2_BEGIN: an inline function with
+// external linkage compiled for AVX2 could be the copy the linker keeps for the whole program.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+namespace
+{
+	struct SseFloat
+	{
+		static const int width = 4;
+
+		struct Mask
+		{
+			__m128 m;
+			inline Mask operator&(const Mask& o) const { return Mask{ _mm_and_ps(this->m, o.m) }; }
+			inline Mask operator|(const Mask& o) const { return Mask{ _mm_or_ps(this->m, o.m) }; }
+			inline bool any() const { return _mm_movemask_ps(this->m) != 0; }
+		};
+
+		__m128 v;
+
+		SseFloat() : v(_mm_setzero_ps()) {};
+		SseFloat(__m128 v) : v(v) {};
+		SseFloat(float f) : v(_mm_set1_ps(f)) {};
+
+		static inline SseFloat load(const float* p) { return SseFloat(_mm_loadu_ps(p)); }
+		inline void store(float* p) const { _mm_storeu_ps(p, this->v); }
+
+		inline SseFloat operator+(const SseFloat& o) const { return _mm_add_ps(this->v, o.v); }
+		inline SseFloat operator-(const SseFloat& o) const { return _mm_sub_ps(this->v, o.v); }
+		inline SseFloat operator*(const SseFloat& o) const { return _mm_mul_ps(this->v, o.v); }
+		inline SseFloat operator/(const SseFloat& o) const { return _mm_div_ps(this->v, o.v); }
+		inline Mask operator<(const SseFloat& o) const { return Mask{ _mm_cmplt_ps(this->v, o.v) }; }
+		inline Mask operator<=(const SseFloat& o) const { return Mask{ _mm_cmple_ps(this->v, o.v) }; }
+		inline Mask operator>(const SseFloat& o) const { return Mask{ _mm_cmpgt_ps(this->v, o.v) }; }
+		inline Mask operator>=(const SseFloat& o) const { return Mask{ _mm_cmpge_ps(this->v, o.v) }; }
+	};
+
+	inline SseFloat select(const SseFloat::Mask& m, const SseFloat& a, const SseFloat& b) { return _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)); }
+	inline SseFloat vsqrt(const SseFloat& a) { return _mm_sqrt_ps(a.v); }
+	inline SseFloat vabs(const SseFloat& a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+	inline SseFloat vmin(const SseFloat& a, const SseFloat& b) { return _mm_min_ps(a.v, b.v); }
+	inline SseFloat vmax(const SseFloat& a, const SseFloat& b) { return _mm_max_ps(a.v, b.v); }
+
+	// SSE2 has no rounding instruction. Converting with the default rounding mode rounds to
+	// nearest, which is all the kernel needs for its small arguments.
+	inline SseFloat vround(const SseFloat& a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+}
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_HAS_AVX2
+#if defined(__clang__)
+#define SIMD_AVX2_BEGIN _Pragma("clang attribute push (__attribute__((target(\"avx2\"))), apply_to = function)")
+#define SIMD_AVX2_END _Pragma("clang attribute pop")
+#else
+#define SIMD_AVX2_BEGIN _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+#define SIMD_AVX2_END _Pragma("GCC pop_options")
+#endif
+#endif
+
+#if defined(SIMD_HAS_AVX2)
+#include <immintrin.h>
+
+SIMD_AVX2_BEGIN
+namespace
+{
+	struct Avx2Float
+	{
+		static const int width = 8;
+
+		struct Mask
+		{
+			__m256 m;
+			inline Mask operator&(const Mask& o) const { return Mask{ _mm256_and_ps(this->m, o.m) }; }
+			inline Mask operator|(const Mask& o) const { return Mask{ _mm256_or_ps(this->m, o.m) }; }
+			inline bool any() const { return _mm256_movemask_ps(this->m) != 0; }
+		};
+
+		__m256 v;
+
+		Avx2Float() : v(_mm256_setzero_ps()) {};
+		Avx2Float(__m256 v) : v(v) {};
+		Avx2Float(float f) : v(_mm256_set1_ps(f)) {};
+
+		static inline Avx2Float load(const float* p) { return Avx2Float(_mm256_loadu_ps(p)); }
+		inline void store(float* p) const { _mm256_storeu_ps(p, this->v); }
+
+		inline Avx2Float operator+(const Avx2Float& o) const { return _mm256_add_ps(this->v, o.v); }
+		inline Avx2Float operator-(const Avx2Float& o) const { return _mm256_sub_ps(this->v, o.v); }
+		inline Avx2Float operator*(const Avx2Float& o) const { return _mm256_mul_ps(this->v, o.v); }
+		inline Avx2Float operator/(const Avx2Float& o) const { return _mm256_div_ps(this->v, o.v); }
+		inline Mask operator<(const Avx2Float& o) const { return Mask{ _mm256_cmp_ps(this->v, o.v, _CMP_LT_OQ) }; }
+		inline Mask operator<=(const Avx2Float& o) const { return Mask{ _mm256_cmp_ps(this->v, o.v, _CMP_LE_OQ) }; }
+		inline Mask operator>(const Avx2Float& o) const { return Mask{ _mm256_cmp_ps(this->v, o.v, _CMP_GT_OQ) }; }
+		inline Mask operator>=(const Avx2Float& o) const { return Mask{ _mm256_cmp_ps(this->v, o.v, _CMP_GE_OQ) }; }
+	};
+
+	inline Avx2Float select(const Avx2Float::Mask& m, const Avx2Float& a, const Avx2Float& b) { return _mm256_blendv_ps(b.v, a.v, m.m); }
+	inline Avx2Float vsqrt(const Avx2Float& a) { return _mm256_sqrt_ps(a.v); }
+	inline Avx2Float vabs(const Avx2Float& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+	inline Avx2Float vmin(const Avx2Float& a, const Avx2Float& b) { return _mm256_min_ps(a.v, b.v); }
+	inline Avx2Float vmax(const Avx2Float& a, const Avx2Float& b) { return _mm256_max_ps(a.v, b.v); }
+	inline Avx2Float vround(const Avx2Float& a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+}
+SIMD_AVX2_END
+#endif
+
+// Whether the AVX2 kernels may be called on this CPU. Compilers without the builtin only get the
+// SSE kernels.
+inline bool cpuHasAvx2()
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+#endif // SIMDFLOAT_H
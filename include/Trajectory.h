@@ -32,7 +32,6 @@ public:
 	virtual ~Segment() {};
 
 	friend class Trajectory;
-	friend class RamTreeNode;
 };
 
 class LinearSegment: public Segment
@@ -108,6 +107,7 @@ public:
 	void resetState();
 	void addLinearSegment(float length, bool forward = true);
 	void addCurveSegment(float angle, float radius, bool rigth);
+	void addRecord(const EdgeRecord& record, float radius);
 	void removeLastSegment();
 	void clear();
 	bool step();
@@ -25,6 +25,9 @@ private:
 	float rearAxleCenterTurnRadius;
 
 	Point2f corners[4];
+	// Collision zone without safety margin in the body frame, x along ori from the rear axle center.
+	Vec2f bodyMin;
+	Vec2f bodyMax;
 
 	float safety = 0.1;
 
@@ -52,6 +55,7 @@ public:
 	inline float getWheelBase() const { return this->wheelbase; }
 	inline float getRearOverhang() const { return this->rearOverhang; }
 	inline float getRearAxleCenterTurnRadius() const { return this->rearAxleCenterTurnRadius; }
+	inline Trajectory* getTraj() const { return this->traj; }
 
 	virtual ~Vehicle();
 
@@ -60,7 +64,8 @@ public:
 
 	virtual bool stepTraj();
 	virtual void teleport(const Point2f& newPos, const Point2f& newOri);
-	const Vec2f* getCollZone(float customSafety = -1) const;
+	// The collision zone as a box: its center lies centerOffset along ori from the pose.
+	void getCollBox(float& centerOffset, float& halfLength, float& halfWidth, float customSafety = -1) const;
 
 	friend class Map;
 };
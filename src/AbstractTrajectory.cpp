@@ -1,10 +1,17 @@
 #include "AbstractTrajectory.h"
-#include "Trajectory.h"
 
 #include <math.h>
+#include <algorithm>
+#include <limits>
 #include <opencv2/imgproc.hpp>
 #include "Map.h"
 
+namespace
+{
+	// Largest turn covered by one box of a curve sweep.
+	const float sweepPieceAngle = 0.2f;
+}
+
 AbstractTrajectory::AbstractTrajectory(const Point2f& startPos, const Vec2f& startOri, float stepLength) :
 	startPos(startPos),
 	startOri(startOri),
@@ -63,6 +70,14 @@ CurveAbstractSegment* AbstractTrajectory::addCurveSegment(float angle, float rad
 	return s;
 }
 
+void AbstractTrajectory::addRecord(const EdgeRecord& record, float radius)
+{
+	if (record.isCurve)
+		this->addCurveSegment(record.angle, radius, record.right);
+	else
+		this->addLinearSegment(record.length, record.direction == 1);
+}
+
 void AbstractTrajectory::removeLastSegment()
 {
 	if (!segments.size())
@@ -129,6 +144,81 @@ bool AbstractTrajectory::step()
 	return false;
 }
 
+// Takes count steps as one, which lands on the same pose without the poses in between.
+bool AbstractTrajectory::step(int count)
+{
+	float stepLength = this->stepLength;
+	this->stepLength *= count;
+	bool end = this->step();
+	this->stepLength = stepLength;
+	return end;
+}
+
+// Upper bound of the speed of a point at most along ahead of or behind the pose and across to its
+// side, relative to the speed of the pose. Turning about a center at radius r to the side, such a
+// point is at most sqrt(along^2 + (r + across)^2) from the center, and moves that many times r as
+// fast.
+float AbstractTrajectory::maxPointSpeed(float along, float across)
+{
+	float speed = 1;
+	for (vector<AbstractSegment*>::iterator it = this->segments.begin(); it != this->segments.end(); it++)
+	{
+		CurveAbstractSegment* curve = dynamic_cast<CurveAbstractSegment*>(*it);
+		if (curve && curve->getRadius() > 0)
+		{
+			float r = curve->getRadius();
+			speed = max(speed, sqrt(along * along + (r + across) * (r + across)) / r);
+		}
+	}
+	return speed;
+}
+
+// Whether the vehicle stays clear driving the whole trajectory. Curves are covered generously, so
+// a hit does not mean a step would collide.
+bool AbstractTrajectory::sweepFree(Map* map, float safety)
+{
+	static thread_local BoxBatch boxes;
+	float centerOffset, halfLength, halfWidth;
+	map->getVehicle().getCollBox(centerOffset, halfLength, halfWidth, safety);
+	for (vector<AbstractSegment*>::iterator it = this->segments.begin(); it != this->segments.end(); it++)
+	{
+		(*it)->sweep(centerOffset, halfLength, halfWidth, boxes);
+		BoxArrays arrays{ boxes.cx.data(), boxes.cy.data(), boxes.ux.data(), boxes.uy.data(), boxes.halfLength, boxes.halfWidth, boxes.size() };
+		if (map->checkBoxes(arrays))
+			return false;
+	}
+	return true;
+}
+
+// Whether any of a batch of steps spread evenly up to truncLength, the farthest first, collides.
+// The steps in between are skipped, so a hit is found without stepping most of the edge. Edges of
+// up to two batches are not probed, as stepping through them costs no more.
+bool AbstractTrajectory::probeHits(Map* map, float truncLength, float safety)
+{
+	static thread_local vector<Point2f> positions;
+	static thread_local vector<Vec2f> orientations;
+	float span = truncLength < 0 ? this->length : min(truncLength, this->length);
+	int steps = (int)ceil(span / this->stepLength);
+	if (steps <= 2 * collisionBatchSize)
+		return false;
+	positions.clear();
+	orientations.clear();
+	this->resetState();
+	for (int i = 1, taken = 0; i <= collisionBatchSize; i++)
+	{
+		int target = i * steps / collisionBatchSize;
+		if (this->step(target - taken))
+			break;
+		taken = target;
+		positions.push_back(this->currPos);
+		orientations.push_back(this->currOri);
+	}
+	this->resetState();
+	reverse(positions.begin(), positions.end());
+	reverse(orientations.begin(), orientations.end());
+	return !positions.empty() && map->checkCollision(positions.data(), orientations.data(), (int)positions.size(), safety) >= 0;
+}
+
 void AbstractTrajectory::restoreLastStep()
 {
 	Point2f pos = this->prevPos;
@@ -158,25 +248,86 @@ void AbstractTrajectory::truncateNow()
 	this->resetState();
 }
 
+// Steps are collected into batches for Map::checkCollision. When a batch has a hit and the
+// chunk before it is kept, the trajectory is stepped again up to the hit and restored from there.
+// With a distance field, a batch starts only once the clearance around the current pose no longer
+// proves the next steps free; until then they are taken in one go without any check.
 bool AbstractTrajectory::truncate(Map* map, float truncLength, bool& truncated, float stepsize, bool useChunk)
 {
+	static thread_local vector<Point2f> positions;
+	static thread_local vector<Vec2f> orientations;
+	const DistanceField& field = map->getDistanceField();
+	float centerOffset, halfLength, halfWidth, pointSpeed = 0;
+	if (field.isBuilt())
+	{
+		map->getVehicle().getCollBox(centerOffset, halfLength, halfWidth, stepsize);
+		pointSpeed = this->maxPointSpeed(abs(centerOffset) + halfLength, halfWidth);
+	}
 	this->resetState();
 	float currLen = 0;
 	bool midSection = true;
 	truncated = false;
-	while ((truncLength < 0 || currLen < truncLength) && (midSection = !this->step()))
+
+	// A whole edge that sweeps free is valid without stepping. Edges cut to truncLength are left to
+	// the steps, as they mostly end at an obstacle and the sweep would be wasted on them.
+	if (truncLength < 0 && this->sweepFree(map, stepsize))
+	{
+		this->step(numeric_limits<int>::max());
+		return true;
+	}
+
+	// An edge that is rejected on any hit gets a coarse probe over its whole length first.
+	if (!useChunk && this->probeHits(map, truncLength, stepsize))
+	{
+		truncated = true;
+		return false;
+	}
+
+	for (int checked = 0;; )
 	{
-		if (map->checkCollision(this->currPos, this->currOri, stepsize))
+		positions.clear();
+		orientations.clear();
+		while ((int)positions.size() < collisionBatchSize && (truncLength < 0 || currLen < truncLength) && (midSection = !this->step()))
+		{
+			currLen += stepsize;
+			if (positions.empty() && pointSpeed > 0)
+			{
+				// This pose and every one less than clearance away are free. A clearance that
+				// proves no further step is left to the batch.
+				float clearance = field.boxClearance(this->currPos, this->currOri, centerOffset, halfLength, halfWidth);
+				int skip = (int)ceil(clearance / (pointSpeed * this->stepLength)) - 1;
+				if (skip > 0)
+				{
+					int steps = 0;
+					for (; steps < skip && (truncLength < 0 || currLen < truncLength); steps++)
+						currLen += stepsize;
+					checked += 1 + steps;
+					if (steps && (midSection = !this->step(steps)) == false)
+						break;
+					continue;
+				}
+			}
+			positions.push_back(this->currPos);
+			orientations.push_back(this->currOri);
+		}
+		if (positions.empty())
+			break;
+		int hit = map->checkCollision(positions.data(), orientations.data(), (int)positions.size(), stepsize);
+		if (hit >= 0)
 		{
 			truncated = true;
-			if (useChunk && currLen > 0)
+			if (useChunk && checked + hit > 0)
 			{
+				this->resetState();
+				for (int i = 0; i <= checked + hit; i++)
+					this->step();
 				this->restoreLastStep();
+				midSection = true;
 				break;
 			}
 			return false;
 		}
-		currLen += stepsize;
+		checked += (int)positions.size();
 	}
 	if (midSection)
 	{
@@ -186,6 +337,19 @@ bool AbstractTrajectory::truncate(Map* map, float truncLength, bool& truncated,
 	return true;
 }
 
+void AbstractTrajectory::cut(float truncLength, bool& truncated)
+{
+	truncated = false;
+	if (truncLength < 0)
+		return;
+	this->resetState();
+	if (!this->step((int)ceil(truncLength / this->stepLength)))
+	{
+		this->truncateNow();
+		truncated = true;
+	}
+}
+
 LinearAbstractSegment::LinearAbstractSegment(const Point2f& start, const Vec2f& ori, float length, bool forward)
 {
 	this->start = start;
@@ -224,9 +388,18 @@ void LinearAbstractSegment::truncateNow()
 	this->length = this->currentSegmentPos;
 }
 
-Segment* LinearAbstractSegment::WTFNewSegment(Map* map)
+EdgeRecord LinearAbstractSegment::toRecord() const
+{
+	return EdgeRecord{ this->length, 0, (signed char)this->direction, false, false };
+}
+
+// The box slides along its own axis, so one longer box is exactly the area it sweeps.
+void LinearAbstractSegment::sweep(float centerOffset, float halfLength, float halfWidth, BoxBatch& boxes) const
 {
-	return new LinearSegment(map, new LinearAbstractSegment(*this));
+	boxes.clear();
+	boxes.halfLength = halfLength + this->length / 2;
+	boxes.halfWidth = halfWidth;
+	boxes.push_back((Vec2f)this->start + this->startOri * (centerOffset + this->direction * this->length / 2), this->startOri);
 }
 
 CurveAbstractSegment::CurveAbstractSegment(const Point2f& start, const Vec2f& startOri, float angle, float radius, bool right) : radius(radius), right(right)
@@ -294,9 +467,48 @@ void CurveAbstractSegment::truncateNow()
 	this->length = this->currentSegmentPos;
 }
 
-Segment* CurveAbstractSegment::WTFNewSegment(Map* map)
+EdgeRecord CurveAbstractSegment::toRecord() const
 {
-	return new CurveSegment(map, new CurveAbstractSegment(*this));
+	signed char direction = (this->angle >= 0) != this->right ? 1 : -1;
+	return EdgeRecord{ this->length, this->angle, direction, true, this->right };
+}
+
+// The turn is split into equal pieces. In the frame of the middle pose of a piece, the curve center
+// is on the y axis and the vehicle box at both ends of the piece is the same for every piece; one
+// box around both, grown by the sagitta of the farthest corner, covers the piece.
+void CurveAbstractSegment::sweep(float centerOffset, float halfLength, float halfWidth, BoxBatch& boxes) const
+{
+	int pieces = max(1, (int)ceil(abs(this->angle) / sweepPieceAngle));
+	float piece = this->angle / pieces;
+	float c = cos(piece / 2), s = sin(piece / 2);
+	Point2f center(0, this->right ? -this->radius : this->radius);
+	Point2f lo(numeric_limits<float>::max(), numeric_limits<float>::max()), hi(-lo.x, -lo.y);
+	float reach = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		Point2f rel = Point2f(centerOffset + (i & 1 ? halfLength : -halfLength), i & 2 ? halfWidth : -halfWidth) - center;
+		reach = max(reach, (float)norm(rel));
+		for (int sign = -1; sign <= 1; sign += 2)
+		{
+			Point2f p = center + Point2f(rel.x * c - sign * rel.y * s, sign * rel.x * s + rel.y * c);
+			lo = Point2f(min(lo.x, p.x), min(lo.y, p.y));
+			hi = Point2f(max(hi.x, p.x), max(hi.y, p.y));
+		}
+	}
+	float sagitta = reach * (1 - c);
+	boxes.clear();
+	boxes.halfLength = (hi.x - lo.x) / 2 + sagitta;
+	boxes.halfWidth = (hi.y - lo.y) / 2 + sagitta;
+	Point2f offset = (lo + hi) / 2;
+	Point2f rel = this->start - this->curveCenter;
+	for (int i = 0; i < pieces; i++)
+	{
+		float a = (i + 0.5f) * piece;
+		float ca = cos(a), sa = sin(a);
+		Point2f pos = this->curveCenter + Point2f(rel.x * ca - rel.y * sa, rel.x * sa + rel.y * ca);
+		Vec2f ori(this->startOri[0] * ca - this->startOri[1] * sa, this->startOri[0] * sa + this->startOri[1] * ca);
+		boxes.push_back((Vec2f)pos + ori * offset.x + Vec2f(-ori[1], ori[0]) * offset.y, ori);
+	}
 }
 
 bool AbstractSegment::checkOverflow(float& stepLength)
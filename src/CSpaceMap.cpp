@@ -0,0 +1,112 @@
+#include "CSpaceMap.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	// Cells classified by one query on each side.
+	const int chunkSize = 16;
+
+	// Monotonic stand-in for the heading in [0, 4), a quarter turn per unit, without atan2. It
+	// turns by at most two radians per unit.
+	inline float diamondAngle(const Vec2f& v)
+	{
+		if (v[1] >= 0)
+			return v[0] >= 0 ? v[1] / (v[0] + v[1]) : 1 - v[0] / (v[1] - v[0]);
+		return v[0] < 0 ? 2 - v[1] / (-v[0] - v[1]) : 3 + v[0] / (v[0] - v[1]);
+	}
+
+	inline Vec2f diamondDirection(float angle)
+	{
+		int quarter = (int)floor(angle);
+		float f = angle - quarter;
+		Vec2f v = normalize(Vec2f(1 - f, f));
+		for (int i = 0; i < quarter; i++)
+			v = Vec2f(-v[1], v[0]);
+		return v;
+	}
+}
+
+// Cells are indexed by the center of the collision box, the point it turns about least. Heading
+// bins are equal steps of the diamond angle. A box within the cell is at most half a cell diagonal
+// from the cell center and turned by at most half a bin, two radians per diamond unit, which moves
+// no point of it further than slack.
+void CSpaceMap::build(const ObstacleStore& obstacles, const Rect2f& area, float resolution, int headingBins, float centerOffset, float halfLength, float halfWidth, float safety)
+{
+	this->x_min = area.x;
+	this->y_min = area.y;
+	this->resolution = resolution;
+	this->invResolution = 1 / resolution;
+	this->headingBins = max(headingBins, 1);
+	this->safety = safety;
+	this->cols = max(1, (int)ceil(area.width / resolution));
+	this->rows = max(1, (int)ceil(area.height / resolution));
+	this->centerOffset = centerOffset;
+	size_t cellCount = (size_t)this->cols * this->rows * this->headingBins;
+	this->cells.assign((cellCount + 31) / 32, 0);
+
+	float reach = sqrt(halfLength * halfLength + halfWidth * halfWidth);
+	float slack = resolution * sqrt(0.5f) + reach * 4.0f / this->headingBins;
+	bool canBlock = halfLength > slack && halfWidth > slack;
+	BoxBatch centers;
+	unsigned char hits[chunkSize];
+
+	for (int b = 0; b < this->headingBins; b++)
+	{
+		Vec2f ori = diamondDirection((b + 0.5f) * 4 / this->headingBins);
+		for (int iy = 0; iy < this->rows; iy++)
+		{
+			for (int ix0 = 0; ix0 < this->cols; ix0 += chunkSize)
+			{
+				int count = min(chunkSize, this->cols - ix0);
+				centers.clear();
+				for (int ix = ix0; ix < ix0 + count; ix++)
+				{
+					centers.push_back(Point2f(this->x_min + (ix + 0.5f) * resolution, this->y_min + (iy + 0.5f) * resolution), ori);
+				}
+				size_t first = ((size_t)b * this->rows + iy) * this->cols + ix0;
+
+				BoxArrays arrays{ centers.cx.data(), centers.cy.data(), centers.ux.data(), centers.uy.data(), halfLength + slack, halfWidth + slack, count };
+				fill(hits, hits + count, 0);
+				obstacles.collideAll(arrays, ObstacleStore::boxBounds(arrays), hits, true);
+				for (int i = 0; i < count; i++)
+					if (!hits[i])
+						this->cells[(first + i) / 32] |= (uint64_t)FREE << (first + i) % 32 * 2;
+
+				if (!canBlock)
+					continue;
+				arrays.halfLength = halfLength - slack;
+				arrays.halfWidth = halfWidth - slack;
+				fill(hits, hits + count, 0);
+				obstacles.collideAll(arrays, ObstacleStore::boxBounds(arrays), hits, false);
+				for (int i = 0; i < count; i++)
+					if (hits[i])
+						this->cells[(first + i) / 32] |= (uint64_t)BLOCKED << (first + i) % 32 * 2;
+			}
+		}
+	}
+}
+
+void CSpaceMap::clear()
+{
+	this->cols = this->rows = 0;
+	this->cells.clear();
+}
+
+CSpaceMap::State CSpaceMap::lookup(const Point2f& pos, const Vec2f& ori, float safety) const
+{
+	if (!this->cols)
+		return MIXED;
+	float fx = (pos.x + ori[0] * this->centerOffset - this->x_min) * this->invResolution;
+	float fy = (pos.y + ori[1] * this->centerOffset - this->y_min) * this->invResolution;
+	if (!(fx >= 0 && fx < this->cols && fy >= 0 && fy < this->rows))
+		return MIXED;
+	int ix = (int)fx, iy = (int)fy;
+	int b = min((int)(diamondAngle(ori) * 0.25f * this->headingBins), this->headingBins - 1);
+	size_t cell = ((size_t)b * this->rows + iy) * this->cols + ix;
+	State state = (State)(this->cells[cell / 32] >> cell % 32 * 2 & 3);
+	if (state == FREE ? safety > this->safety : safety < this->safety)
+		return MIXED;
+	return state;
+}
@@ -0,0 +1,132 @@
+#include "CollisionBatch.h"
+#include "SimdFloat.h"
+
+#include <math.h>
+
+void BoxBatch::clear()
+{
+	this->cx.clear();
+	this->cy.clear();
+	this->ux.clear();
+	this->uy.clear();
+}
+
+void BoxBatch::push_back(const Point2f& center, const Vec2f& ori)
+{
+	this->cx.push_back(center.x);
+	this->cy.push_back(center.y);
+	this->ux.push_back(ori[0]);
+	this->uy.push_back(ori[1]);
+}
+
+// A segment has the same edge twice, so it only needs its normal once.
+ConvexShape::ConvexShape(const Point2f* points, int size) : size(min(size, 4))
+{
+	this->axes = this->size == 2 ? 1 : this->size;
+	this->center = Point2f(0, 0);
+	for (int i = 0; i < this->size; i++)
+	{
+		this->points[i] = points[i];
+		this->center += points[i] / this->size;
+	}
+	this->radius = 0;
+	for (int i = 0; i < this->size; i++)
+		this->radius = max(this->radius, (float)norm(this->points[i] - this->center));
+	for (int n = 0; n < this->axes; n++)
+	{
+		Point2f edge = this->points[(n + 1) % this->size] - this->points[n];
+		this->normals[n] = Vec2f(-edge.y, edge.x);
+		this->minProj[n] = this->maxProj[n] = this->normals[n].dot(Vec2f(this->points[0].x, this->points[0].y));
+		for (int i = 1; i < this->size; i++)
+		{
+			float proj = this->normals[n].dot(Vec2f(this->points[i].x, this->points[i].y));
+			this->minProj[n] = min(this->minProj[n], proj);
+			this->maxProj[n] = max(this->maxProj[n], proj);
+		}
+	}
+}
+
+bool isConvex(const Point2f* points, int size)
+{
+	bool left = false, right = false;
+	for (int i = 0; i < size; i++)
+	{
+		Point2f e1 = points[(i + 1) % size] - points[i];
+		Point2f e2 = points[(i + 2) % size] - points[(i + 1) % size];
+		float cross = e1.x * e2.y - e1.y * e2.x;
+		left = left || cross > 0;
+		right = right || cross < 0;
+	}
+	return !(left && right);
+}
+
+// Same tests as CollisionBatchKernel.h, one box at a time.
+void collision_scalar::collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits)
+{
+	float step = boxes.halfLength / footprintCircles;
+	float boundReach = sqrt(boxes.halfLength * boxes.halfLength + boxes.halfWidth * boxes.halfWidth) + shape.radius;
+	float circleReach = sqrt(step * step + boxes.halfWidth * boxes.halfWidth) + shape.radius;
+	for (int i = 0; i < boxes.count; i++)
+	{
+		float sx = shape.center.x - boxes.cx[i], sy = shape.center.y - boxes.cy[i];
+		if (sx * sx + sy * sy > boundReach * boundReach)
+			continue;
+		float su = sx * boxes.ux[i] + sy * boxes.uy[i];
+		float sv = sy * boxes.ux[i] - sx * boxes.uy[i];
+		float closest = 1e30f;
+		for (int c = 0; c < footprintCircles; c++)
+			closest = min(closest, abs(su + boxes.halfLength - (2 * c + 1) * step));
+		if (closest * closest + sv * sv > circleReach * circleReach)
+			continue;
+		if (abs(su) <= boxes.halfLength && abs(sv) <= boxes.halfWidth)
+		{
+			hits[i] = 1;
+			continue;
+		}
+
+		float minU = 1e30f, maxU = -1e30f, minV = 1e30f, maxV = -1e30f;
+		for (int p = 0; p < shape.size; p++)
+		{
+			float dx = shape.points[p].x - boxes.cx[i], dy = shape.points[p].y - boxes.cy[i];
+			float pu = dx * boxes.ux[i] + dy * boxes.uy[i];
+			float pv = dy * boxes.ux[i] - dx * boxes.uy[i];
+			minU = min(minU, pu);
+			maxU = max(maxU, pu);
+			minV = min(minV, pv);
+			maxV = max(maxV, pv);
+		}
+		bool hit = minU <= boxes.halfLength && maxU >= -boxes.halfLength && minV <= boxes.halfWidth && maxV >= -boxes.halfWidth;
+		for (int n = 0; hit && n < shape.axes; n++)
+		{
+			float nx = shape.normals[n][0], ny = shape.normals[n][1];
+			float c = boxes.cx[i] * nx + boxes.cy[i] * ny;
+			float r = boxes.halfLength * abs(boxes.ux[i] * nx + boxes.uy[i] * ny) + boxes.halfWidth * abs(boxes.ux[i] * ny - boxes.uy[i] * nx);
+			hit = c - r <= shape.maxProj[n] && c + r >= shape.minProj[n];
+		}
+		if (hit)
+			hits[i] = 1;
+	}
+}
+
+namespace
+{
+	typedef void (*CollisionKernel)(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits);
+
+	CollisionKernel selectKernel()
+	{
+		if (cpuHasAvx2())
+			return collision_avx2::collide;
+#if defined(__SSE2__) || defined(_M_X64)
+		return collision_sse::collide;
+#else
+		return collision_scalar::collide;
+#endif
+	}
+
+	const CollisionKernel collisionKernel = selectKernel();
+}
+
+void collideBoxes(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits)
+{
+	collisionKernel(boxes, shape, hits);
+}
@@ -0,0 +1,25 @@
+// The kernel is compiled for AVX2 through SIMD_AVX2_BEGIN, the rest of the file is not. Only
+// called after a runtime CPU check.
+#include "CollisionBatch.h"
+#include "SimdFloat.h"
+
+#include <math.h>
+
+#if defined(SIMD_HAS_AVX2)
+SIMD_AVX2_BEGIN
+#include "CollisionBatchKernel.h"
+
+void collision_avx2::collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits)
+{
+	collideKernel<Avx2Float>(boxes, shape, hits);
+}
+SIMD_AVX2_END
+
+#else
+
+void collision_avx2::collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits)
+{
+	collision_scalar::collide(boxes, shape, hits);
+}
+
+#endif
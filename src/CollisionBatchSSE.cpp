@@ -0,0 +1,21 @@
+// SSE2 is part of every x86-64 CPU, so this kernel needs no runtime check there.
+#include "CollisionBatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include "SimdFloat.h"
+
+#include "CollisionBatchKernel.h"
+
+void collision_sse::collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits)
+{
+	collideKernel<SseFloat>(boxes, shape, hits);
+}
+
+#else
+
+void collision_sse::collide(const BoxArrays& boxes, const ConvexShape& shape, unsigned char* hits)
+{
+	collision_scalar::collide(boxes, shape, hits);
+}
+
+#endif
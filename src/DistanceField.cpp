@@ -0,0 +1,53 @@
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <math.h>
+
+void DistanceField::build(const ObstacleStore& obstacles, const Rect2f& area, float resolution)
+{
+	this->x_min = area.x;
+	this->y_min = area.y;
+	this->resolution = resolution;
+	this->invResolution = 1 / resolution;
+	this->cols = max(1, (int)ceil(area.width / resolution));
+	this->rows = max(1, (int)ceil(area.height / resolution));
+	this->cells.resize((size_t)this->cols * this->rows);
+	float halfDiagonal = resolution * sqrt(0.5f);
+	for (int iy = 0; iy < this->rows; iy++)
+	{
+		for (int ix = 0; ix < this->cols; ix++)
+		{
+			Point2f center(this->x_min + (ix + 0.5f) * resolution, this->y_min + (iy + 0.5f) * resolution);
+			float distance = max(0.0f, obstacles.distance(center, maxDistance) - halfDiagonal);
+			this->cells[(size_t)iy * this->cols + ix] = (unsigned char)min(floor(distance / quantum), 255.0f);
+		}
+	}
+}
+
+void DistanceField::clear()
+{
+	this->cols = this->rows = 0;
+	this->cells.clear();
+}
+
+float DistanceField::distance(const Point2f& p) const
+{
+	float fx = (p.x - this->x_min) * this->invResolution;
+	float fy = (p.y - this->y_min) * this->invResolution;
+	if (!(fx >= 0 && fx < this->cols && fy >= 0 && fy < this->rows))
+		return 0;
+	return this->cells[(size_t)(int)fy * this->cols + (int)fx] * quantum;
+}
+
+float DistanceField::boxClearance(const Point2f& pos, const Vec2f& ori, float centerOffset, float halfLength, float halfWidth) const
+{
+	float step = halfLength / boxCircles;
+	float radius = sqrt(step * step + halfWidth * halfWidth);
+	float clearance = maxDistance;
+	for (int i = 0; i < boxCircles; i++)
+	{
+		Point2f center = (Vec2f)pos + ori * (centerOffset - halfLength + (2 * i + 1) * step);
+		clearance = min(clearance, this->distance(center) - radius);
+	}
+	return clearance;
+}
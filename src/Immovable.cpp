@@ -5,7 +5,7 @@
 #include <opencv2/imgproc.hpp>
 
 
-Immovable::Immovable(Map* map, const vector<float>& coords, int rowNum) : MapObject(map, rowNum), centroid(0,0), range(0)
+Immovable::Immovable(Map* map, const vector<float>& coords, int rowNum) : MapObject(map, rowNum)
 {
 	for (int i = 0; i < rowNum; i++)
 	{
@@ -14,27 +14,12 @@ Immovable::Immovable(Map* map, const vector<float>& coords, int rowNum) : MapObj
 		point.y = coords[i * 3 + 1];
 		this->points.push_back(point);
 	}
-	for (int i = 0; i < this->points.size(); i++)
-	{
-		centroid += points[i];
-	}
-	centroid.x /= this->points.size();
-	centroid.y /= this->points.size();
-	for (int i = 0; i < this->points.size(); i++)
-	{
-		range = max<float>(range, norm(points[i] - centroid));
-	}
 }
 
 Immovable::~Immovable()
 {
 }
 
-bool Immovable::checkCollision(Point2f collZoneCorners[4])
-{
-	return checkConcavePolyPolyCollision(&(this->points[0]), collZoneCorners);
-}
-
 void Immovable::calculateCVPoints()
 {
 	this->cvPointCount = (int)this->points.size();
@@ -65,15 +50,22 @@ void Wall::draw() const
 	line(this->map->map, cvPoints[0], cvPoints[1], Scalar(1, 0, 0, 1), 1);
 }
 
-bool Wall::checkCollision(Point2f collZoneCorners[4])
+
+void ParkingSpot::activate()
 {
-	return checkLineConcavePolyCollision(this->points[0], this->points[1], collZoneCorners);
+	this->activeTarget = true;
+	this->map->updateSpot(this);
 }
 
+void ParkingSpot::deactivate()
+{
+	this->activeTarget = false;
+	this->map->updateSpot(this);
+}
 
 void ParkingSpot::setPreTargets()
 {
-	this->activeTarget = true;
+	this->activate();
 	Point2f frontCenter = (this->points[0] + this->points[3]) / 2;
 	Point2f rearCenter = (this->points[1] + this->points[2]) / 2;
 
@@ -110,7 +102,7 @@ void ParkingSpot::setPreTargets()
 			}
 		}
 	}
-	this->activeTarget = false;
+	this->deactivate();
 }
 
 ParkingSpot::ParkingSpot(Map* map, const vector<float>& coords) : Immovable(map, coords, 4), activeTarget(false), prePos()
@@ -149,12 +141,4 @@ void ParkingSpot::draw() const
 	if (this->activeTarget)
 		for (vector<CarConfiguration*>::const_iterator it = this->prePos.begin(); it != this->prePos.end(); it++)
 			circle(this->map->map, Point2f((*it)->pos.x * this->map->getScale() + this->map->getOffsetX(), (*it)->pos.y * this->map->getScale() + this->map->getOffsetY()), 5, Scalar(1, 0, 0, 1), -1);
-}
-
-
-bool ParkingSpot::checkCollision(Point2f collZoneCorners[4])
-{
-	if (this->activeTarget)
-		return false;
-	return Immovable::checkCollision(collZoneCorners);
 }
\ No newline at end of file
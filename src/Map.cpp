@@ -8,6 +8,9 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
 #include <math.h>
 
 Map::Map(const string& mapFile, const string& windowName, int width, int height, Scalar background) : objects(),
@@ -25,7 +28,10 @@ Map::Map(const string& mapFile, const string& windowName, int width, int height,
 	                                                                                                  offset_x(0),
 	                                                                                                  offset_y(0),
 																									  activePSIndex(0),
-																									  tree(0)
+																									  tree(0),
+																									  observer(0),
+																									  settings(),
+																									  treeCount(0)
 {
 	this->vehicle = new Vehicle(this, this->vPos, this->vOri, this->vLength, this->vWidth, this->vWheelbase, this->vRearOverhang);
 
@@ -54,12 +60,15 @@ Map::Map(const string& mapFile, const string& windowName, int width, int height,
 			{
 			case Immovable::ObjectType::PILLAR:
 				object = new Pillar(this, tokens);
+				this->obstacles.addQuad(&object->points[0], (int)object->points.size());
 				break;
 			case Immovable::ObjectType::WALL:
 				object = new Wall(this, tokens);
+				this->obstacles.addSegment(object->points[0], object->points[1]);
 				break;
 			case Immovable::ObjectType::PARKING_SPOT:
 				object = new ParkingSpot(this, tokens);
+				this->obstacles.addSpot(&object->points[0], (int)object->points.size());
 				pss.push_back(dynamic_cast<ParkingSpot*>(object));
 				break;
 			default:
@@ -67,17 +76,9 @@ Map::Map(const string& mapFile, const string& windowName, int width, int height,
 			}
 			objects.push_back(object);
 		}
-		if (pss.size())
-		{
-			for (vector<ParkingSpot*>::iterator it = pss.begin(); it != pss.end(); it++)
-				(*it)->setPreTargets();
-			this->pss[this->activePSIndex]->activate();
-			this->createNewTree();
-		}
-		else
+		if (!pss.size())
 			throw runtime_error("No parking spots were defined in the input file.");
 
-
 		bool extremesSet = false;
 		for (vector<Immovable*>::const_iterator it = this->objects.begin(); it != this->objects.end(); it++)
 		{
@@ -100,17 +101,22 @@ Map::Map(const string& mapFile, const string& windowName, int width, int height,
 				}
 			}
 		}
+		// Cells about the size of the vehicle keep a query to a handful of cells.
+		this->obstacles.build(this->vLength);
 		this->scale = min<float>((float)width / (this->x_max - this->x_min) * 0.9f, (float)height / (this->y_max - this->y_min) * 0.9f);
 		this->offset_x = float(width) / 2.0f - (this->x_min + (this->x_max - this->x_min) / 2.0f) * scale;
 		this->offset_y = float(height) / 2.0f - (this->y_min + (this->y_max - this->y_min) / 2.0f) * scale;
+
+		for (vector<ParkingSpot*>::iterator it = pss.begin(); it != pss.end(); it++)
+			(*it)->setPreTargets();
+		this->pss[this->activePSIndex]->activate();
+		this->createNewTree();
 	}
 	else
 	{
 		throw runtime_error("Could not open mapfile");
 	}
 	this->calculateCVPoints();
-
-	setMouseCallback(this->windowName, Map::mouseCallback, this);
 }
 
 Map::~Map()
@@ -155,28 +161,114 @@ void Map::unsetBlob()
 	this->blob = 0;
 }
 
+// Plans until a trajectory is found or the request runs out. In optimize mode the whole budget
+// is spent improving the path. Returns whether a trajectory was accepted, including one found
+// before a cancellation or the deadline.
+bool Map::plan(const PlanRequest& request)
+{
+	PlanBudget budget(request);
+	if (this->settings.bidirectional)
+		return this->planBidirectional(budget);
+	if (this->settings.portfolioSize > 1 && !this->settings.optimize)
+		return this->planPortfolio(budget);
+
+	this->reset();
+	if (this->settings.growthThreads > 1 && !this->settings.optimize)
+		return this->finishPlanning(this->tree->growConcurrent(this->settings.growthThreads, budget));
+	for (int i = 0; !budget.exhausted(i); i++)
+	{
+		if (this->observer && !this->observer->onPlanStep(*this, this->getProgress(budget)))
+			break;
+		if (this->addRRTNode() && !this->settings.optimize)
+			break;
+	}
+	return this->finishPlanning(this->tree->isTargetReached());
+}
+
 bool Map::planTrajectory(int steps)
+{
+	PlanRequest request;
+	request.steps = steps;
+	return this->plan(request);
+}
+
+// The trees only read the map while they grow, so they can race on separate threads.
+// The observer is not polled during the race, as it would render trees that are being modified.
+bool Map::planPortfolio(const PlanBudget& budget)
 {
 	this->reset();
-	for (int i = 0; i < steps; i++)
+	vector<RamTree*> trees(1, this->tree);
+	for (int i = 1; i < this->settings.portfolioSize; i++)
+		trees.push_back(this->newTree());
+
+	atomic<int> winner(-1);
+	vector<thread> workers;
+	for (int i = 0; i < (int)trees.size(); i++)
 	{
-		if (waitKey(1) == 'p')
-		{
-			this->reset();
-			return true;
-		}
-		if (this->addRRTNode())
+		workers.push_back(thread([&trees, &winner, &budget, i]()
 		{
-			Trajectory* t = this->composeTrajectoryFromTree();
-			t->addLinearSegment(norm(this->pss[this->activePSIndex]->getFinalPos() - t->getEndPos()), false);
-			t->setColor(Scalar(0, 0, 1, 1));
-			this->vehicle->setTraj(t);
-			this->draw();
-			return true;
-		}
-		this->draw();
+			for (int step = 0; !budget.exhausted(step) && winner.load(memory_order_relaxed) < 0; step++)
+			{
+				if (trees[i]->addRRTNode())
+				{
+					int none = -1;
+					winner.compare_exchange_strong(none, i);
+					return;
+				}
+			}
+		}));
+	}
+	for (vector<thread>::iterator it = workers.begin(); it != workers.end(); it++)
+		it->join();
+
+	this->tree = trees[max(winner.load(), 0)];
+	for (vector<RamTree*>::iterator it = trees.begin(); it != trees.end(); it++)
+		if (*it != this->tree)
+			delete *it;
+
+	return this->finishPlanning(winner.load() >= 0);
+}
+
+// The vehicle tree and a goal tree rooted at the pre-targets take turns growing towards a sample,
+// each followed by an attempt of the other tree to connect to the new node.
+bool Map::planBidirectional(const PlanBudget& budget)
+{
+	this->reset();
+	PlannerSettings goalSettings = this->settings;
+	goalSettings.seed += this->treeCount++;
+	RamTree goal(this, this->pss[this->activePSIndex]->getPrePos(), goalSettings, this->vehicle->getRearAxleCenterTurnRadius());
+	for (int i = 0; !budget.exhausted(i); i++)
+	{
+		if (this->observer && !this->observer->onPlanStep(*this, this->getProgress(budget)))
+			break;
+		if (this->tree->addConnectNode(&goal, i % 2 == 1))
+			break;
 	}
-	return false;
+	return this->finishPlanning(this->tree->isTargetReached());
+}
+
+bool Map::finishPlanning(bool success)
+{
+	if (success)
+		this->acceptTrajectory();
+	else if (this->observer)
+		this->observer->onPlanFinished(*this, false);
+	return success;
+}
+
+PlanProgress Map::getProgress(const PlanBudget& budget) const
+{
+	return PlanProgress{ this->tree->getNodeCount(), this->tree->getBestCost(), budget.elapsed() };
+}
+
+void Map::acceptTrajectory()
+{
+	Trajectory* t = this->composeTrajectoryFromTree();
+	t->addLinearSegment(norm(this->pss[this->activePSIndex]->getFinalPos() - t->getEndPos()), false);
+	t->setColor(Scalar(0, 0, 1, 1));
+	this->vehicle->setTraj(t);
+	if (this->observer)
+		this->observer->onPlanFinished(*this, true);
 }
 
 void Map::reset()
@@ -190,11 +282,57 @@ void Map::reset()
 	this->isAnimationFinished = false;
 }
 
+RamTree* Map::newTree()
+{
+	PlannerSettings treeSettings = this->settings;
+	treeSettings.seed += this->treeCount++;
+	return new RamTree(this, this->vPos, this->vOri, this->pss[this->activePSIndex]->getPrePos(), treeSettings, this->vehicle->getRearAxleCenterTurnRadius());
+}
+
 void Map::createNewTree()
 {
 	if (this->tree);
 		delete this->tree;
-	this->tree = new RamTree(this, this->vPos, this->vOri, this->pss[this->activePSIndex]->getPrePos(), this->vehicle->getRearAxleCenterTurnRadius());
+	this->tree = this->newTree();
+}
+
+void Map::setPlannerSettings(const PlannerSettings& settings)
+{
+	this->settings = settings;
+	this->buildCSpace();
+	this->buildDistanceField();
+	this->treeCount = 0;
+	this->reset();
+}
+
+// Built for the default safety margin of the vehicle, which is also the step size of tree edges.
+void Map::buildCSpace()
+{
+	if (this->settings.cspaceResolution <= 0)
+	{
+		this->cspace.clear();
+		return;
+	}
+	if (this->cspace.isBuilt() && this->cspace.getResolution() == this->settings.cspaceResolution && this->cspace.getHeadingBins() == this->settings.cspaceHeadingBins)
+		return;
+	float centerOffset, halfLength, halfWidth;
+	float safety = this->vehicle->getSafety();
+	this->vehicle->getCollBox(centerOffset, halfLength, halfWidth, safety);
+	Rect2f area(this->x_min, this->y_min, this->x_max - this->x_min, this->y_max - this->y_min);
+	this->cspace.build(this->obstacles, area, this->settings.cspaceResolution, this->settings.cspaceHeadingBins, centerOffset, halfLength, halfWidth, safety);
+}
+
+void Map::buildDistanceField()
+{
+	if (this->settings.distanceFieldResolution <= 0)
+	{
+		this->distances.clear();
+		return;
+	}
+	if (this->distances.isBuilt() && this->distances.getResolution() == this->settings.distanceFieldResolution)
+		return;
+	Rect2f area(this->x_min, this->y_min, this->x_max - this->x_min, this->y_max - this->y_min);
+	this->distances.build(this->obstacles, area, this->settings.distanceFieldResolution);
 }
 
 void Map::startStop()
@@ -212,30 +350,58 @@ void Map::simulateStep()
 
 bool Map::checkCollision(const Point2f& pos, const Vec2f ori, float safety)
 {
-	Point2f realCollZoneCorners[4];
-	const Vec2f* collZoneCorners = this->vehicle->getCollZone(safety);
-	float theta = getAngleBetween(Vec2f(1, 0), ori);
-	for (int i = 0; i < 4; i++)
-	{
-		realCollZoneCorners[i] = (Vec2f)pos + rotateVector(collZoneCorners[i], theta);
-	}
-	delete collZoneCorners;
-
-	Point2f tail = (Vec2f)pos - ori * this->vehicle->getRearOverhang();
-	Point2f nose = (Vec2f)tail + ori * this->vehicle->getLenght();
-	Point2f center = (tail + nose) / 2;
-
-	float range = sqrt(pow(this->vehicle->getLenght() + this->vehicle->getSafety() * 2, 2) + pow(this->vehicle->getWidth() + this->vehicle->getSafety() * 2, 2));
+	return this->checkCollision(&pos, &ori, 1, safety) >= 0;
+}
 
-	for (vector<Immovable*>::const_iterator it = this->objects.begin(); it != this->objects.end(); it++)
+// Checks count poses at once and returns the index of the first colliding one, or -1. Poses the
+// configuration space map can tell about skip the exact test.
+int Map::checkCollision(const Point2f* pos, const Vec2f* ori, int count, float safety)
+{
+	static thread_local BoxBatch boxes;
+	static thread_local vector<int> poses;
+	static thread_local vector<unsigned char> hits;
+	float centerOffset;
+	boxes.clear();
+	poses.clear();
+	if (safety < 0)
+		safety = this->vehicle->getSafety();
+	this->vehicle->getCollBox(centerOffset, boxes.halfLength, boxes.halfWidth, safety);
+	Point2f lo(numeric_limits<float>::max(), numeric_limits<float>::max()), hi(-lo.x, -lo.y);
+	int blocked = -1;
+	for (int i = 0; i < count; i++)
 	{
-		if (norm(center - (*it)->getCentroid()) < range + (*it)->getRange())
+		CSpaceMap::State state = this->cspace.lookup(pos[i], ori[i], safety);
+		if (state == CSpaceMap::FREE)
+			continue;
+		if (state == CSpaceMap::BLOCKED)
 		{
-			if ((*it)->checkCollision(realCollZoneCorners))
-				return true;
+			blocked = i;
+			break;
 		}
+		Point2f center = (Vec2f)pos[i] + ori[i] * centerOffset;
+		boxes.push_back(center, ori[i]);
+		poses.push_back(i);
+		float reachX = abs(ori[i][0]) * boxes.halfLength + abs(ori[i][1]) * boxes.halfWidth;
+		float reachY = abs(ori[i][1]) * boxes.halfLength + abs(ori[i][0]) * boxes.halfWidth;
+		lo = Point2f(min(lo.x, center.x - reachX), min(lo.y, center.y - reachY));
+		hi = Point2f(max(hi.x, center.x + reachX), max(hi.y, center.y + reachY));
 	}
-	return false;
+	if (!boxes.size())
+		return blocked;
+
+	hits.assign(boxes.size(), 0);
+	BoxArrays arrays{ boxes.cx.data(), boxes.cy.data(), boxes.ux.data(), boxes.uy.data(), boxes.halfLength, boxes.halfWidth, boxes.size() };
+	int hit = this->obstacles.collide(arrays, Rect2f(lo.x, lo.y, hi.x - lo.x, hi.y - lo.y), hits.data());
+	return hit >= 0 ? poses[hit] : blocked;
+}
+
+bool Map::checkBoxes(const BoxArrays& boxes)
+{
+	static thread_local vector<unsigned char> hits;
+	if (!boxes.count)
+		return false;
+	hits.assign(boxes.count, 0);
+	return this->obstacles.collide(boxes, ObstacleStore::boxBounds(boxes), hits.data()) >= 0;
 }
 
 bool Map::addRRTNode()
@@ -256,6 +422,13 @@ void Map::activateNextSpot(bool forward)
 	this->tree->targets = this->pss[this->activePSIndex]->getPrePos();
 }
 
+void Map::updateSpot(ParkingSpot* spot)
+{
+	int index = (int)(find(this->pss.begin(), this->pss.end(), spot) - this->pss.begin());
+	if (index < (int)this->pss.size())
+		this->obstacles.setSpotSolid(index, !spot->isActiveTarget());
+}
+
 void Map::mouseCallback(int event, int x, int y, int flags, void* userdata)
 {
 	Map* map = (Map*)userdata;
@@ -0,0 +1,242 @@
+#include "NodeIndex.h"
+#include "RamTree.h"
+#include "brutil.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+NodeIndex::NodeIndex(float x_min, float x_max, float y_min, float y_max, float minTurnRadius, const RSCTable* table, float cellSize, int headingBins) : x_min(x_min),
+																																 y_min(y_min),
+																																 cellSize(cellSize),
+																																 headingBins(max(headingBins, 1)),
+																																 minTurnRadius(minTurnRadius),
+																																 table(table),
+																																 entries(),
+																																 heads()
+{
+	if (this->cellSize <= 0)
+		this->cellSize = max(minTurnRadius, 1.0f);
+	this->cols = max(1, (int)ceil((x_max - x_min) / this->cellSize));
+	this->rows = max(1, (int)ceil((y_max - y_min) / this->cellSize));
+	int cellCount = this->cols * this->rows * this->headingBins;
+	this->heads.reset(new atomic<int>[cellCount]);
+	for (int i = 0; i < cellCount; i++)
+		this->heads[i].store(-1, memory_order_relaxed);
+}
+
+int NodeIndex::cellX(float x) const
+{
+	return min(max((int)floor((x - this->x_min) / this->cellSize), 0), this->cols - 1);
+}
+
+int NodeIndex::cellY(float y) const
+{
+	return min(max((int)floor((y - this->y_min) / this->cellSize), 0), this->rows - 1);
+}
+
+int NodeIndex::headingBin(float heading) const
+{
+	return min(max((int)floor((heading + CV_PI) / CV_2PI * this->headingBins), 0), this->headingBins - 1);
+}
+
+int NodeIndex::cell(const Point2f& pos, float heading) const
+{
+	return (this->cellY(pos.y) * this->cols + this->cellX(pos.x)) * this->headingBins + this->headingBin(heading);
+}
+
+// Border cells also hold every node clamped into them, so they extend to infinity outwards.
+float NodeIndex::cellDist(int ix, int iy, const Point2f& pos) const
+{
+	float x0 = this->x_min + ix * this->cellSize;
+	float y0 = this->y_min + iy * this->cellSize;
+	float dx = 0, dy = 0;
+	if (ix > 0 && pos.x < x0)
+		dx = x0 - pos.x;
+	else if (ix < this->cols - 1 && pos.x > x0 + this->cellSize)
+		dx = pos.x - x0 - this->cellSize;
+	if (iy > 0 && pos.y < y0)
+		dy = y0 - pos.y;
+	else if (iy < this->rows - 1 && pos.y > y0 + this->cellSize)
+		dy = pos.y - y0 - this->cellSize;
+	return sqrt(dx * dx + dy * dy);
+}
+
+float NodeIndex::binDist(int bin, float heading) const
+{
+	float binWidth = CV_2PI / this->headingBins;
+	float center = -CV_PI + (bin + 0.5f) * binWidth;
+	return max(0.0f, abs(reduceAngle(heading - center)) - binWidth / 2);
+}
+
+float NodeIndex::lowerBound(const Point2f& from, float fromHeading, const Point2f& to, float toHeading, float minTurnRadius)
+{
+	float dx = to.x - from.x;
+	float dy = to.y - from.y;
+	return max(sqrt(dx * dx + dy * dy), minTurnRadius * abs(reduceAngle(toHeading - fromHeading)));
+}
+
+// Table length in the frame of the from pose, or -1 without a table or outside of it.
+float NodeIndex::tableLength(const Point2f& from, float fromHeading, float cosFrom, float sinFrom, const Point2f& to, float toHeading) const
+{
+	if (!this->table)
+		return -1;
+	float dx = (to.x - from.x) / this->minTurnRadius;
+	float dy = (to.y - from.y) / this->minTurnRadius;
+	float length = this->table->lookup(dx * cosFrom + dy * sinFrom, dy * cosFrom - dx * sinFrom, reduceAngle(toHeading - fromHeading));
+	return length < 0 ? -1 : length * this->minTurnRadius;
+}
+
+NodeIndex::Candidate NodeIndex::rank(int e, const Point2f& pos, float heading) const
+{
+	const Entry& entry = this->entries[e];
+	float lb = lowerBound(entry.pos, entry.heading, pos, heading, this->minTurnRadius);
+	float length = this->tableLength(entry.pos, entry.heading, entry.cosHeading, entry.sinHeading, pos, heading);
+	if (length < 0)
+		return Candidate{ e, lb, lb };
+	return Candidate{ e, max(lb, length - this->table->getErrorBound() * this->minTurnRadius), length };
+}
+
+float NodeIndex::estimate(const Point2f& from, float fromHeading, const Point2f& to, float toHeading) const
+{
+	float length = this->tableLength(from, fromHeading, cos(fromHeading), sin(fromHeading), to, toHeading);
+	return length < 0 ? lowerBound(from, fromHeading, to, toHeading, this->minTurnRadius) : length;
+}
+
+void NodeIndex::insert(RamTreeNode* node)
+{
+	Point2f pos = node->getPos();
+	Vec2f ori = node->getOri();
+	float heading = atan2(ori[1], ori[0]);
+	int cell = this->cell(pos, heading);
+
+	int e = (int)this->entries.claim();
+	Entry& entry = this->entries[e];
+	entry.node = node;
+	entry.pos = pos;
+	entry.heading = heading;
+	entry.cosHeading = cos(heading);
+	entry.sinHeading = sin(heading);
+	int head = this->heads[cell].load(memory_order_relaxed);
+	do
+		entry.next = head;
+	while (!this->heads[cell].compare_exchange_weak(head, e, memory_order_release, memory_order_relaxed));
+	this->entries.publish(e);
+}
+
+void NodeIndex::remove(RamTreeNode* node)
+{
+	Vec2f ori = node->getOri();
+	int cell = this->cell(node->getPos(), atan2(ori[1], ori[0]));
+	for (int e = this->heads[cell].load(memory_order_relaxed), prev = -1; e >= 0; prev = e, e = this->entries[e].next)
+	{
+		if (this->entries[e].node != node)
+			continue;
+		if (prev < 0)
+			this->heads[cell].store(this->entries[e].next, memory_order_relaxed);
+		else
+			this->entries[prev].next = this->entries[e].next;
+		return;
+	}
+}
+
+NearestNode NodeIndex::findNearest(const Point2f& pos, const Vec2f ori) const
+{
+	static thread_local vector<Candidate> shortlist;
+	static thread_local PoseBatch batch;
+	static thread_local vector<int> batchEntries;
+	int limit = (int)this->entries.size();
+	float heading = atan2(ori[1], ori[0]);
+	int qx = this->cellX(pos.x);
+	int qy = this->cellY(pos.y);
+	int maxRing = max(max(qx, this->cols - 1 - qx), max(qy, this->rows - 1 - qy));
+
+	RamTreeNode* minNode = 0;
+	RSCPath shortestRSC;
+	float best = numeric_limits<float>::infinity();
+	for (int r = 0; r <= maxRing && (r - 1) * this->cellSize < best; r++)
+	{
+		shortlist.clear();
+		for (int iy = max(qy - r, 0); iy <= min(qy + r, this->rows - 1); iy++)
+		{
+			int step = (iy == qy - r || iy == qy + r) ? 1 : 2 * r;
+			for (int ix = qx - r; ix <= qx + r; ix += step)
+			{
+				if (ix < 0 || ix >= this->cols)
+					continue;
+				float dist = this->cellDist(ix, iy, pos);
+				if (dist >= best)
+					continue;
+				for (int b = 0; b < this->headingBins; b++)
+				{
+					int head = this->heads[(iy * this->cols + ix) * this->headingBins + b].load(memory_order_acquire);
+					if (head < 0 || this->minTurnRadius * this->binDist(b, heading) >= best)
+						continue;
+					for (int e = head; e >= 0; e = this->entries[e].next)
+					{
+						if (e >= limit)
+							continue;
+						Candidate candidate = this->rank(e, pos, heading);
+						if (candidate.lowerBound < best)
+							shortlist.push_back(candidate);
+					}
+				}
+			}
+		}
+		sort(shortlist.begin(), shortlist.end(), [](const Candidate& a, const Candidate& b) { return a.estimate < b.estimate; });
+		// Candidates are measured in SIMD batches; only the winner of a batch gets its exact path.
+		for (int next = 0; next < (int)shortlist.size();)
+		{
+			batch.clear();
+			batchEntries.clear();
+			for (; next < (int)shortlist.size() && batch.size() < batchSize; next++)
+			{
+				if (shortlist[next].lowerBound >= best)
+					continue;
+				const Entry& entry = this->entries[shortlist[next].entry];
+				batch.push_back(entry.pos, entry.heading);
+				batchEntries.push_back(shortlist[next].entry);
+			}
+			float length;
+			int i = rscBatchArgmin(batch, 0, batch.size(), pos, heading, this->minTurnRadius, length);
+			if (i < 0 || length >= best)
+				continue;
+			RamTreeNode* node = this->entries[batchEntries[i]].node;
+			RSCPath currRSC = node->calculateDist(pos, ori, best);
+			if (currRSC.size() && currRSC.length < best)
+			{
+				best = currRSC.length;
+				shortestRSC = currRSC;
+				minNode = node;
+			}
+		}
+	}
+	return NearestNode{ minNode, shortestRSC };
+}
+
+void NodeIndex::findNear(const Point2f& pos, const Vec2f ori, float radius, vector<RamTreeNode*>& nodes) const
+{
+	int limit = (int)this->entries.size();
+	float heading = atan2(ori[1], ori[0]);
+	int qx = this->cellX(pos.x);
+	int qy = this->cellY(pos.y);
+	int reach = (int)ceil(radius / this->cellSize);
+	for (int iy = max(qy - reach, 0); iy <= min(qy + reach, this->rows - 1); iy++)
+	{
+		for (int ix = max(qx - reach, 0); ix <= min(qx + reach, this->cols - 1); ix++)
+		{
+			if (this->cellDist(ix, iy, pos) >= radius)
+				continue;
+			for (int b = 0; b < this->headingBins; b++)
+			{
+				if (this->minTurnRadius * this->binDist(b, heading) >= radius)
+					continue;
+				for (int e = this->heads[(iy * this->cols + ix) * this->headingBins + b].load(memory_order_acquire); e >= 0; e = this->entries[e].next)
+				{
+					if (e < limit && lowerBound(this->entries[e].pos, this->entries[e].heading, pos, heading, this->minTurnRadius) < radius)
+						nodes.push_back(this->entries[e].node);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#include "ObstacleGrid.h"
+
+void ObstacleGrid::build(const vector<Rect2f>& bounds, float cellSize)
+{
+	this->bounds = bounds;
+	this->cellSize = cellSize;
+	this->cellStart.clear();
+	this->cellObjects.clear();
+	if (bounds.empty())
+	{
+		this->cols = this->rows = 0;
+		return;
+	}
+	float x_max = bounds[0].x + bounds[0].width, y_max = bounds[0].y + bounds[0].height;
+	this->x_min = bounds[0].x;
+	this->y_min = bounds[0].y;
+	for (vector<Rect2f>::const_iterator it = bounds.begin(); it != bounds.end(); it++)
+	{
+		this->x_min = min(this->x_min, it->x);
+		this->y_min = min(this->y_min, it->y);
+		x_max = max(x_max, it->x + it->width);
+		y_max = max(y_max, it->y + it->height);
+	}
+	this->cols = max(1, (int)ceil((x_max - this->x_min) / cellSize));
+	this->rows = max(1, (int)ceil((y_max - this->y_min) / cellSize));
+
+	// Counting pass, then every object is written into its cells.
+	this->cellStart.assign(this->cols * this->rows + 1, 0);
+	for (vector<Rect2f>::const_iterator it = bounds.begin(); it != bounds.end(); it++)
+		for (int iy = this->cellY(it->y); iy <= this->cellY(it->y + it->height); iy++)
+			for (int ix = this->cellX(it->x); ix <= this->cellX(it->x + it->width); ix++)
+				this->cellStart[iy * this->cols + ix + 1]++;
+	for (int i = 0; i < this->cols * this->rows; i++)
+		this->cellStart[i + 1] += this->cellStart[i];
+	this->cellObjects.resize(this->cellStart.back());
+	vector<int> fill(this->cellStart.begin(), this->cellStart.end() - 1);
+	for (int i = 0; i < (int)bounds.size(); i++)
+		for (int iy = this->cellY(bounds[i].y); iy <= this->cellY(bounds[i].y + bounds[i].height); iy++)
+			for (int ix = this->cellX(bounds[i].x); ix <= this->cellX(bounds[i].x + bounds[i].width); ix++)
+				this->cellObjects[fill[iy * this->cols + ix]++] = i;
+}
@@ -0,0 +1,171 @@
+#include "ObstacleStore.h"
+
+#include <limits>
+#include <math.h>
+
+// The reflex vertex turns against the orientation of the polygon.
+void ObstacleStore::addPolygon(const Point2f* points, int size, vector<ConvexShape>& shapes)
+{
+	if (size != 4 || isConvex(points, size))
+	{
+		shapes.push_back(ConvexShape(points, size));
+		return;
+	}
+	float area = 0;
+	for (int i = 0; i < size; i++)
+		area += points[i].x * points[(i + 1) % size].y - points[(i + 1) % size].x * points[i].y;
+	int reflex = 0;
+	for (int i = 0; i < size; i++)
+	{
+		Point2f e1 = points[i] - points[(i + size - 1) % size];
+		Point2f e2 = points[(i + 1) % size] - points[i];
+		if ((e1.x * e2.y - e1.y * e2.x) * area < 0)
+		{
+			reflex = i;
+			break;
+		}
+	}
+	Point2f first[3] = { points[reflex], points[(reflex + 1) % size], points[(reflex + 2) % size] };
+	Point2f second[3] = { points[(reflex + 2) % size], points[(reflex + 3) % size], points[reflex] };
+	shapes.push_back(ConvexShape(first, 3));
+	shapes.push_back(ConvexShape(second, 3));
+}
+
+// Zero inside the shape, otherwise the distance to the closest edge.
+float ObstacleStore::pointDistance(const ConvexShape& shape, const Point2f& p)
+{
+	float best = numeric_limits<float>::max();
+	int left = 0, right = 0;
+	for (int i = 0; i < shape.size; i++)
+	{
+		Point2f a = shape.points[i], b = shape.points[(i + 1) % shape.size];
+		Point2f edge = b - a, rel = p - a;
+		float cross = edge.x * rel.y - edge.y * rel.x;
+		left += cross >= 0;
+		right += cross <= 0;
+		float t = edge.dot(edge) > 0 ? min(max(edge.dot(rel) / edge.dot(edge), 0.0f), 1.0f) : 0;
+		Point2f closest = rel - edge * t;
+		best = min(best, closest.dot(closest));
+	}
+	if (shape.size > 2 && (left == shape.size || right == shape.size))
+		return 0;
+	return sqrt(best);
+}
+
+void ObstacleStore::addQuad(const Point2f* points, int size)
+{
+	addPolygon(points, size, this->quads);
+}
+
+void ObstacleStore::addSegment(const Point2f& a, const Point2f& b)
+{
+	Point2f points[2] = { a, b };
+	this->segments.push_back(ConvexShape(points, 2));
+}
+
+int ObstacleStore::addSpot(const Point2f* points, int size)
+{
+	int spot = (int)this->solidSpots.size();
+	addPolygon(points, size, this->spots);
+	this->spotOwners.resize(this->spots.size(), spot);
+	this->solidSpots.push_back(true);
+	return spot;
+}
+
+// Grid indices run through quads, then segments, then spots.
+void ObstacleStore::build(float cellSize)
+{
+	vector<Rect2f> bounds;
+	const vector<ConvexShape>* kinds[] = { &this->quads, &this->segments, &this->spots };
+	for (int k = 0; k < 3; k++)
+	{
+		for (vector<ConvexShape>::const_iterator it = kinds[k]->begin(); it != kinds[k]->end(); it++)
+		{
+			Point2f lo = it->points[0], hi = it->points[0];
+			for (int i = 1; i < it->size; i++)
+			{
+				lo = Point2f(min(lo.x, it->points[i].x), min(lo.y, it->points[i].y));
+				hi = Point2f(max(hi.x, it->points[i].x), max(hi.y, it->points[i].y));
+			}
+			bounds.push_back(Rect2f(lo.x, lo.y, hi.x - lo.x, hi.y - lo.y));
+		}
+	}
+	this->grid.build(bounds, cellSize);
+}
+
+Rect2f ObstacleStore::boxBounds(const BoxArrays& boxes)
+{
+	Point2f lo(1e30f, 1e30f), hi(-1e30f, -1e30f);
+	for (int i = 0; i < boxes.count; i++)
+	{
+		float reachX = abs(boxes.ux[i]) * boxes.halfLength + abs(boxes.uy[i]) * boxes.halfWidth;
+		float reachY = abs(boxes.uy[i]) * boxes.halfLength + abs(boxes.ux[i]) * boxes.halfWidth;
+		lo = Point2f(min(lo.x, boxes.cx[i] - reachX), min(lo.y, boxes.cy[i] - reachY));
+		hi = Point2f(max(hi.x, boxes.cx[i] + reachX), max(hi.y, boxes.cy[i] + reachY));
+	}
+	return Rect2f(lo.x, lo.y, hi.x - lo.x, hi.y - lo.y);
+}
+
+int ObstacleStore::collide(const BoxArrays& boxes, const Rect2f& bounds, unsigned char* hits) const
+{
+	int segmentBase = (int)this->quads.size();
+	int spotBase = segmentBase + (int)this->segments.size();
+	BoxArrays pending = boxes;
+	this->grid.any(bounds, [&](int i)
+	{
+		const ConvexShape* shape;
+		if (i < segmentBase)
+			shape = &this->quads[i];
+		else if (i < spotBase)
+			shape = &this->segments[i - segmentBase];
+		else if (this->solidSpots[this->spotOwners[i - spotBase]])
+			shape = &this->spots[i - spotBase];
+		else
+			return false;
+		collideBoxes(pending, *shape, hits);
+		for (int b = 0; b < pending.count; b++)
+		{
+			if (hits[b])
+			{
+				pending.count = b;
+				break;
+			}
+		}
+		return pending.count == 0;
+	});
+	return pending.count < boxes.count ? pending.count : -1;
+}
+
+void ObstacleStore::collideAll(const BoxArrays& boxes, const Rect2f& bounds, unsigned char* hits, bool spots) const
+{
+	int segmentBase = (int)this->quads.size();
+	int spotBase = segmentBase + (int)this->segments.size();
+	this->grid.any(bounds, [&](int i)
+	{
+		if (i < segmentBase)
+			collideBoxes(boxes, this->quads[i], hits);
+		else if (i < spotBase)
+			collideBoxes(boxes, this->segments[i - segmentBase], hits);
+		else if (spots)
+			collideBoxes(boxes, this->spots[i - spotBase], hits);
+		return false;
+	});
+}
+
+float ObstacleStore::distance(const Point2f& p, float maxDistance) const
+{
+	int segmentBase = (int)this->quads.size();
+	int spotBase = segmentBase + (int)this->segments.size();
+	float best = maxDistance;
+	this->grid.any(Rect2f(p.x - maxDistance, p.y - maxDistance, 2 * maxDistance, 2 * maxDistance), [&](int i)
+	{
+		if (i < segmentBase)
+			best = min(best, pointDistance(this->quads[i], p));
+		else if (i < spotBase)
+			best = min(best, pointDistance(this->segments[i - segmentBase], p));
+		else
+			best = min(best, pointDistance(this->spots[i - spotBase], p));
+		return best == 0;
+	});
+	return best;
+}
@@ -1,176 +1,260 @@
 #include "RSC.h"
 #include "brutil.h"
 
-float sumRSCPath(const vector<PathElem>& rsc)
-{
-	float len = 0;
-	for (vector<PathElem>::const_iterator it = rsc.begin(); it != rsc.end(); it++)
-		len += it->length;
-	return len;
-}
+#include <limits>
+#include <math.h>
 
-bool rscComp(const vector<PathElem>& rsc1, const vector<PathElem>& rsc2)
+// Reeds-Shepp words on the unit circle, after Reeds and Shepp (1990) with the corrections
+// made in OMPL. Segment values are signed, negative values are driven backwards.
+namespace
 {
-	float len1 = 0, len2 = 0;
-	for (vector<PathElem>::const_iterator it = rsc1.begin(); it != rsc1.end(); it++)
+	const float ZERO = 1e-5f;
+	const float HALF_PI = (float)(CV_PI / 2);
+
+	enum SegmentType
+	{
+		RS_NOP,
+		RS_LEFT,
+		RS_STRAIGHT,
+		RS_RIGHT,
+	};
+
+	const SegmentType words[18][5] = {
+		{ RS_LEFT, RS_RIGHT, RS_LEFT, RS_NOP, RS_NOP },
+		{ RS_RIGHT, RS_LEFT, RS_RIGHT, RS_NOP, RS_NOP },
+		{ RS_LEFT, RS_RIGHT, RS_LEFT, RS_RIGHT, RS_NOP },
+		{ RS_RIGHT, RS_LEFT, RS_RIGHT, RS_LEFT, RS_NOP },
+		{ RS_LEFT, RS_RIGHT, RS_STRAIGHT, RS_LEFT, RS_NOP },
+		{ RS_RIGHT, RS_LEFT, RS_STRAIGHT, RS_RIGHT, RS_NOP },
+		{ RS_LEFT, RS_STRAIGHT, RS_RIGHT, RS_LEFT, RS_NOP },
+		{ RS_RIGHT, RS_STRAIGHT, RS_LEFT, RS_RIGHT, RS_NOP },
+		{ RS_LEFT, RS_RIGHT, RS_STRAIGHT, RS_RIGHT, RS_NOP },
+		{ RS_RIGHT, RS_LEFT, RS_STRAIGHT, RS_LEFT, RS_NOP },
+		{ RS_RIGHT, RS_STRAIGHT, RS_RIGHT, RS_LEFT, RS_NOP },
+		{ RS_LEFT, RS_STRAIGHT, RS_LEFT, RS_RIGHT, RS_NOP },
+		{ RS_LEFT, RS_STRAIGHT, RS_RIGHT, RS_NOP, RS_NOP },
+		{ RS_RIGHT, RS_STRAIGHT, RS_LEFT, RS_NOP, RS_NOP },
+		{ RS_LEFT, RS_STRAIGHT, RS_LEFT, RS_NOP, RS_NOP },
+		{ RS_RIGHT, RS_STRAIGHT, RS_RIGHT, RS_NOP, RS_NOP },
+		{ RS_LEFT, RS_RIGHT, RS_STRAIGHT, RS_LEFT, RS_RIGHT },
+		{ RS_RIGHT, RS_LEFT, RS_STRAIGHT, RS_RIGHT, RS_LEFT },
+	};
+
+	struct Word
 	{
-		len1 += it->length;
+		int type;
+		float segments[5];
+		float length;
+	};
+
+	inline void consider(Word& best, int type, float t, float u, float v, float w = 0, float x = 0)
+	{
+		float length = abs(t) + abs(u) + abs(v) + abs(w) + abs(x);
+		if (length < best.length)
+			best = Word{ type, { t, u, v, w, x }, length };
 	}
-	for (vector<PathElem>::const_iterator it = rsc2.begin(); it != rsc2.end(); it++)
+
+	// The base formulas take sin and cos of phi from the caller, as all symmetric variants of a
+	// query share them up to sign.
+	inline bool LpSpLp(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
 	{
-		len2 += it->length;
+		getPolar(Point2f(x - s, y - 1 + c), u, t);
+		if (t < -ZERO)
+			return false;
+		v = reduceAngle(phi - t);
+		return v >= -ZERO;
 	}
-	return len1 < len2;
-}
 
-vector<PathElem> rscMin(const vector<vector<PathElem>>& paths)
-{
-	vector<PathElem> shortest;
-	if (!paths.empty())
+	inline bool LpSpRp(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
 	{
-		shortest = paths[0];
-		for (vector<vector<PathElem>>::const_iterator it = paths.begin()+1; it != paths.end(); it++)
-		{
-			if (!rscComp(shortest, *it))
-				shortest = *it;
-		}
+		float t1, u1;
+		getPolar(Point2f(x + s, y - 1 - c), u1, t1);
+		u1 = u1 * u1;
+		if (u1 < 4)
+			return false;
+		u = sqrt(u1 - 4);
+		t = reduceAngle(t1 + atan2(2.0f, u));
+		v = reduceAngle(t - phi);
+		return t >= -ZERO && v >= -ZERO;
 	}
-	return shortest;
-}
 
+	inline bool LpRmL(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
+	{
+		float u1, theta;
+		getPolar(Point2f(x - s, y - 1 + c), u1, theta);
+		if (u1 > 4)
+			return false;
+		u = -2 * asin(0.25f * u1);
+		t = reduceAngle(theta + 0.5f * u + (float)CV_PI);
+		v = reduceAngle(phi - t + u);
+		return t >= -ZERO && u <= ZERO;
+	}
 
-void reverse(vector<PathElem>& pathElems)
-{
-	for (vector<PathElem>::iterator it = pathElems.begin(); it != pathElems.end(); it++)
+	inline void tauOmega(float u, float v, float xi, float eta, float phi, float& tau, float& omega)
 	{
-		it->isForward *= -1;
+		float delta = reduceAngle(u - v);
+		float A = sin(u) - sin(delta);
+		float B = cos(u) - cos(delta) - 1;
+		float t1 = atan2(eta * A - xi * B, xi * A + eta * B);
+		float t2 = 2 * (cos(delta) - cos(v) - cos(u)) + 3;
+		tau = t2 < 0 ? reduceAngle(t1 + (float)CV_PI) : reduceAngle(t1);
+		omega = reduceAngle(tau - u + v - phi);
 	}
-}
 
-void mirror(vector<PathElem>& pathElems)
-{
-	for (vector<PathElem>::iterator it = pathElems.begin(); it != pathElems.end(); it++)
+	inline bool LpRupLumRm(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
 	{
-		it->isLeft *= -1;
+		float xi = x + s, eta = y - 1 - c;
+		float rho = 0.25f * (2 + sqrt(xi * xi + eta * eta));
+		if (rho > 1)
+			return false;
+		u = acos(rho);
+		tauOmega(u, -u, xi, eta, phi, t, v);
+		return t >= -ZERO && v <= ZERO;
 	}
-}
 
-vector<PathElem> planPath1(Point2f targetPos, float phi, float rMin)
-{
-	float r, theta;
-	getPolar(targetPos, r, theta);
-	float t, u, v;
-	getPolar(Point2f(targetPos.x - rMin * sin(phi), targetPos.y - rMin* (1 - cos(phi))), u, t);
-	v = reduceAngle(phi - t);
-
-	vector<PathElem> ret;
-	//if (t >= 0 && u >= 0 && v >= 0)
-	if (u >= 0)
+	inline bool LpRumLumRp(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
 	{
-		ret.push_back(PathElem{ true, t, rMin * abs(t), 1, 1 });
-		ret.push_back(PathElem{ false, 0, u, 0, 1 });
-		ret.push_back(PathElem{ true, v, rMin * abs(v), 1, 1 });
+		float xi = x + s, eta = y - 1 - c;
+		float rho = (20 - xi * xi - eta * eta) / 16;
+		if (rho < 0 || rho > 1)
+			return false;
+		u = -acos(rho);
+		if (u < -HALF_PI)
+			return false;
+		tauOmega(u, u, xi, eta, phi, t, v);
+		return t >= -ZERO && v >= -ZERO;
 	}
-	return ret;
-}
 
-vector<PathElem> planPath2(Point2f targetPos, float phi, float rMin)
-{
-	float r, theta;
-	getPolar(targetPos, r, theta);
-	float t, u, v;
-	getPolar(Point2f(targetPos.x + rMin * sin(phi), targetPos.y - rMin * (1 + cos(phi))), u, t);
-	vector<PathElem> ret;
-	if (u * u >= 4 * rMin * rMin)
+	inline bool LpRmSmLm(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
 	{
-		u = sqrt(u * u - 4 * rMin * rMin);
-		t = reduceAngle(t + atan2(2 * rMin, u));
-		v = reduceAngle(t - phi);
-		//if (t >= 0 && u >= 0 && v >= 0)
-		if (u >= 0)
-		{
-			ret.push_back(PathElem{ true, t, rMin * abs(t), 1, 1 });
-			ret.push_back(PathElem{ false, 0, u, 0, 1});
-			ret.push_back(PathElem{ true, v, rMin * abs(v), -1, 1 });
-		}
+		float rho, theta;
+		getPolar(Point2f(x - s, y - 1 + c), rho, theta);
+		if (rho < 2)
+			return false;
+		float r = sqrt(rho * rho - 4);
+		u = 2 - r;
+		t = reduceAngle(theta + atan2(r, -2.0f));
+		v = reduceAngle(phi - HALF_PI - t);
+		return t >= -ZERO && u <= ZERO && v <= ZERO;
 	}
-	return ret;
-}
 
-vector<PathElem> planPath3(Point2f targetPos, float phi, float rMin)
-{
-	float theta;
-	float xi = targetPos.x - rMin * sin(phi);
-	float eta = targetPos.y - rMin * (1 - cos(phi));
-	float t, u, v;
-	getPolar(Point2f(xi,eta), u, theta);
-		
-	vector<PathElem> ret;
-	if (u <= 4 * rMin)
+	inline bool LpRmSmRm(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
 	{
-		float A = acos(u / (4 * rMin));
-		t = reduceAngle(theta + CV_PI /2 + A);
-		u = reduceAngle(CV_PI - 2 * A);
-		v = reduceAngle(phi - t - u);
-		
-		//if (t >= 0 && u >= 0 && v >= 0)
-		//{
-			ret.push_back(PathElem{ true, t, rMin * abs(t), 1, 1 });
-			ret.push_back(PathElem{ true, u, rMin * abs(u), -1, -1 });
-			ret.push_back(PathElem{ true, v, rMin * abs(v), 1, 1 });
-		//}
+		float rho, theta;
+		float xi = x + s, eta = y - 1 - c;
+		getPolar(Point2f(-eta, xi), rho, theta);
+		if (rho < 2)
+			return false;
+		t = theta;
+		u = 2 - rho;
+		v = reduceAngle(t + HALF_PI - phi);
+		return t >= -ZERO && u <= ZERO && v <= ZERO;
 	}
-	return ret;
-}
 
-vector<PathElem> planPath4(Point2f targetPos, float phi, float rMin)
-{
-	float theta;
-	float xi = targetPos.x - rMin * sin(phi);
-	float eta = targetPos.y - rMin * (1 - cos(phi));
-	float t, u, v;
-	getPolar(Point2f(xi, eta), u, theta);
-
-	vector<PathElem> ret;
-	if (u <= 4 * rMin)
+	inline bool LpRmSLmRp(float x, float y, float phi, float s, float c, float& t, float& u, float& v)
+	{
+		float rho, theta;
+		float xi = x + s, eta = y - 1 - c;
+		getPolar(Point2f(xi, eta), rho, theta);
+		if (rho < 2)
+			return false;
+		u = 4 - sqrt(rho * rho - 4);
+		if (u > ZERO)
+			return false;
+		t = reduceAngle(atan2((4 - u) * xi - 2 * eta, -2 * xi + (u - 4) * eta));
+		v = reduceAngle(t - phi);
+		return t >= -ZERO && v >= -ZERO;
+	}
+
+	// Every base formula is tried on the query, its timeflip (-x, y, -phi), its reflection
+	// (x, -y, -phi) and both (-x, -y, phi). The CCC and CCSC words are also tried backwards.
+	// The CCSC and CCSCC words contain one or two fixed quarter turns, so they are skipped
+	// once a shorter word has been found.
+	void evaluateWords(float x, float y, float phi, Word& best)
 	{
-		float A = acos(u / (4 * rMin));
-		t = reduceAngle(theta + CV_PI / 2 + A);
-		u = reduceAngle(CV_PI - 2 * A);
-		v = reduceAngle(t + u - phi);
-
-		//if (t >= 0 && u >= 0 && v >= 0)
-		//{
-		ret.push_back(PathElem{ true, t, rMin * abs(t), 1, 1 });
-		ret.push_back(PathElem{ true, u, rMin * abs(u), -1, -1 });
-		ret.push_back(PathElem{ true, v, rMin * abs(v), 1, -1 });
-		//}
+		float s = sin(phi), c = cos(phi);
+		float xb = x * c + y * s, yb = x * s - y * c;
+		float t, u, v;
+
+		if (LpSpLp(x, y, phi, s, c, t, u, v)) consider(best, 14, t, u, v);
+		if (LpSpLp(-x, y, -phi, -s, c, t, u, v)) consider(best, 14, -t, -u, -v);
+		if (LpSpLp(x, -y, -phi, -s, c, t, u, v)) consider(best, 15, t, u, v);
+		if (LpSpLp(-x, -y, phi, s, c, t, u, v)) consider(best, 15, -t, -u, -v);
+		if (LpSpRp(x, y, phi, s, c, t, u, v)) consider(best, 12, t, u, v);
+		if (LpSpRp(-x, y, -phi, -s, c, t, u, v)) consider(best, 12, -t, -u, -v);
+		if (LpSpRp(x, -y, -phi, -s, c, t, u, v)) consider(best, 13, t, u, v);
+		if (LpSpRp(-x, -y, phi, s, c, t, u, v)) consider(best, 13, -t, -u, -v);
+
+		if (LpRmL(x, y, phi, s, c, t, u, v)) consider(best, 0, t, u, v);
+		if (LpRmL(-x, y, -phi, -s, c, t, u, v)) consider(best, 0, -t, -u, -v);
+		if (LpRmL(x, -y, -phi, -s, c, t, u, v)) consider(best, 1, t, u, v);
+		if (LpRmL(-x, -y, phi, s, c, t, u, v)) consider(best, 1, -t, -u, -v);
+		if (LpRmL(xb, yb, phi, s, c, t, u, v)) consider(best, 0, v, u, t);
+		if (LpRmL(-xb, yb, -phi, -s, c, t, u, v)) consider(best, 0, -v, -u, -t);
+		if (LpRmL(xb, -yb, -phi, -s, c, t, u, v)) consider(best, 1, v, u, t);
+		if (LpRmL(-xb, -yb, phi, s, c, t, u, v)) consider(best, 1, -v, -u, -t);
+
+		if (LpRupLumRm(x, y, phi, s, c, t, u, v)) consider(best, 2, t, u, -u, v);
+		if (LpRupLumRm(-x, y, -phi, -s, c, t, u, v)) consider(best, 2, -t, -u, u, -v);
+		if (LpRupLumRm(x, -y, -phi, -s, c, t, u, v)) consider(best, 3, t, u, -u, v);
+		if (LpRupLumRm(-x, -y, phi, s, c, t, u, v)) consider(best, 3, -t, -u, u, -v);
+		if (LpRumLumRp(x, y, phi, s, c, t, u, v)) consider(best, 2, t, u, u, v);
+		if (LpRumLumRp(-x, y, -phi, -s, c, t, u, v)) consider(best, 2, -t, -u, -u, -v);
+		if (LpRumLumRp(x, -y, -phi, -s, c, t, u, v)) consider(best, 3, t, u, u, v);
+		if (LpRumLumRp(-x, -y, phi, s, c, t, u, v)) consider(best, 3, -t, -u, -u, -v);
+
+		if (best.length <= HALF_PI)
+			return;
+		if (LpRmSmLm(x, y, phi, s, c, t, u, v)) consider(best, 4, t, -HALF_PI, u, v);
+		if (LpRmSmLm(-x, y, -phi, -s, c, t, u, v)) consider(best, 4, -t, HALF_PI, -u, -v);
+		if (LpRmSmLm(x, -y, -phi, -s, c, t, u, v)) consider(best, 5, t, -HALF_PI, u, v);
+		if (LpRmSmLm(-x, -y, phi, s, c, t, u, v)) consider(best, 5, -t, HALF_PI, -u, -v);
+		if (LpRmSmRm(x, y, phi, s, c, t, u, v)) consider(best, 8, t, -HALF_PI, u, v);
+		if (LpRmSmRm(-x, y, -phi, -s, c, t, u, v)) consider(best, 8, -t, HALF_PI, -u, -v);
+		if (LpRmSmRm(x, -y, -phi, -s, c, t, u, v)) consider(best, 9, t, -HALF_PI, u, v);
+		if (LpRmSmRm(-x, -y, phi, s, c, t, u, v)) consider(best, 9, -t, HALF_PI, -u, -v);
+		if (LpRmSmLm(xb, yb, phi, s, c, t, u, v)) consider(best, 6, v, u, -HALF_PI, t);
+		if (LpRmSmLm(-xb, yb, -phi, -s, c, t, u, v)) consider(best, 6, -v, -u, HALF_PI, -t);
+		if (LpRmSmLm(xb, -yb, -phi, -s, c, t, u, v)) consider(best, 7, v, u, -HALF_PI, t);
+		if (LpRmSmLm(-xb, -yb, phi, s, c, t, u, v)) consider(best, 7, -v, -u, HALF_PI, -t);
+		if (LpRmSmRm(xb, yb, phi, s, c, t, u, v)) consider(best, 10, v, u, -HALF_PI, t);
+		if (LpRmSmRm(-xb, yb, -phi, -s, c, t, u, v)) consider(best, 10, -v, -u, HALF_PI, -t);
+		if (LpRmSmRm(xb, -yb, -phi, -s, c, t, u, v)) consider(best, 11, v, u, -HALF_PI, t);
+		if (LpRmSmRm(-xb, -yb, phi, s, c, t, u, v)) consider(best, 11, -v, -u, HALF_PI, -t);
+
+		if (best.length <= (float)CV_PI)
+			return;
+		if (LpRmSLmRp(x, y, phi, s, c, t, u, v)) consider(best, 16, t, -HALF_PI, u, -HALF_PI, v);
+		if (LpRmSLmRp(-x, y, -phi, -s, c, t, u, v)) consider(best, 16, -t, HALF_PI, -u, HALF_PI, -v);
+		if (LpRmSLmRp(x, -y, -phi, -s, c, t, u, v)) consider(best, 17, t, -HALF_PI, u, -HALF_PI, v);
+		if (LpRmSLmRp(-x, -y, phi, s, c, t, u, v)) consider(best, 17, -t, HALF_PI, -u, HALF_PI, -v);
 	}
-	return ret;
 }
 
-vector<PathElem> planPath5(Point2f targetPos, float phi, float rMin)
+// Any path is at least as long as the straight line and turns at least the heading difference,
+// which rejects hopeless queries before a single word is evaluated.
+RSCPath planShortestPath(const Point2f& targetPos, float phi, float rMin, float upperBound)
 {
-	float r, theta;
-	float xi = targetPos.x - rMin * sin(phi);
-	float eta = targetPos.y - rMin * (1 - cos(phi));
-	getPolar(Point2f(xi, eta), r, theta);
-	float t, u, v;
-
-	vector<PathElem> ret;
-	if (r <= 4 * rMin)
+	RSCPath ret;
+	float x = targetPos.x / rMin, y = targetPos.y / rMin;
+	phi = reduceAngle(phi);
+	Word best{ -1, {}, upperBound / rMin };
+	if (max(sqrt(x * x + y * y), abs(phi)) >= best.length)
+		return ret;
+	evaluateWords(x, y, phi, best);
+
+	if (best.type < 0)
+		return ret;
+	for (int i = 0; i < 5 && words[best.type][i] != RS_NOP; i++)
 	{
-		u = acos(1 - r * r / (8 * rMin * rMin));
-		float A = asin(2 * rMin * sin(u) / r);
-		t = reduceAngle(theta + CV_PI / 2 - A);
-		v = reduceAngle(t - u - phi);
-
-		//if (t >= 0 && u >= 0 && v >= 0)
-		//{
-		ret.push_back(PathElem{ true, t, rMin * abs(t), 1, 1 });
-		ret.push_back(PathElem{ true, u, rMin * abs(u), -1, 1 });
-		ret.push_back(PathElem{ true, v, rMin * abs(v), 1, -1 });
-		//}
+		float value = best.segments[i];
+		if (abs(value) < ZERO)
+			continue;
+		int direction = value < 0 ? -1 : 1;
+		if (words[best.type][i] == RS_STRAIGHT)
+			ret.push_back(PathElem{ false, 0, rMin * abs(value), 0, direction });
+		else
+			ret.push_back(PathElem{ true, abs(value), rMin * abs(value), words[best.type][i] == RS_LEFT ? 1 : -1, direction });
 	}
 	return ret;
 }
@@ -0,0 +1,68 @@
+#include "RSCBatch.h"
+#include "RSC.h"
+#include "brutil.h"
+#include "SimdFloat.h"
+
+#include <math.h>
+
+void PoseBatch::clear()
+{
+	this->x.clear();
+	this->y.clear();
+	this->heading.clear();
+	this->cosHeading.clear();
+	this->sinHeading.clear();
+}
+
+void PoseBatch::push_back(const Point2f& pos, float heading)
+{
+	this->x.push_back(pos.x);
+	this->y.push_back(pos.y);
+	this->heading.push_back(heading);
+	this->cosHeading.push_back(cos(heading));
+	this->sinHeading.push_back(sin(heading));
+}
+
+int rscbatch_scalar::argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length)
+{
+	int bestIndex = -1;
+	length = 0;
+	for (int i = 0; i < poses.count; i++)
+	{
+		float dx = x - poses.x[i];
+		float dy = y - poses.y[i];
+		Point2f target(dx * poses.cosHeading[i] + dy * poses.sinHeading[i], dy * poses.cosHeading[i] - dx * poses.sinHeading[i]);
+		RSCPath path = planShortestPath(target, heading - poses.heading[i], rMin, bestIndex < 0 ? numeric_limits<float>::infinity() : length);
+		if (path.size())
+		{
+			bestIndex = i;
+			length = path.length;
+		}
+	}
+	return bestIndex;
+}
+
+namespace
+{
+	typedef int (*BatchKernel)(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length);
+
+	BatchKernel selectKernel()
+	{
+		if (cpuHasAvx2())
+			return rscbatch_avx2::argmin;
+#if defined(__SSE2__) || defined(_M_X64)
+		return rscbatch_sse::argmin;
+#else
+		return rscbatch_scalar::argmin;
+#endif
+	}
+
+	const BatchKernel batchKernel = selectKernel();
+}
+
+int rscBatchArgmin(const PoseBatch& poses, int first, int count, const Point2f& pos, float heading, float rMin, float& length)
+{
+	PoseArrays arrays{ poses.x.data() + first, poses.y.data() + first, poses.heading.data() + first, poses.cosHeading.data() + first, poses.sinHeading.data() + first, count };
+	int index = batchKernel(arrays, pos.x, pos.y, heading, rMin, length);
+	return index < 0 ? -1 : first + index;
+}
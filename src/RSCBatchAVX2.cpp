@@ -0,0 +1,25 @@
+// The kernel is compiled for AVX2 through SIMD_AVX2_BEGIN, the rest of the file is not. Only
+// called after a runtime CPU check.
+#include "RSCBatch.h"
+#include "SimdFloat.h"
+
+#include <math.h>
+
+#if defined(SIMD_HAS_AVX2)
+SIMD_AVX2_BEGIN
+#include "RSCBatchKernel.h"
+
+int rscbatch_avx2::argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length)
+{
+	return batchArgmin<Avx2Float>(poses, x, y, heading, rMin, length);
+}
+SIMD_AVX2_END
+
+#else
+
+int rscbatch_avx2::argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length)
+{
+	return rscbatch_scalar::argmin(poses, x, y, heading, rMin, length);
+}
+
+#endif
@@ -0,0 +1,21 @@
+// SSE2 is part of every x86-64 CPU, so this kernel needs no runtime check there.
+#include "RSCBatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include "SimdFloat.h"
+
+#include "RSCBatchKernel.h"
+
+int rscbatch_sse::argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length)
+{
+	return batchArgmin<SseFloat>(poses, x, y, heading, rMin, length);
+}
+
+#else
+
+int rscbatch_sse::argmin(const PoseArrays& poses, float x, float y, float heading, float rMin, float& length)
+{
+	return rscbatch_scalar::argmin(poses, x, y, heading, rMin, length);
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "RSCTable.h"
+#include "RSC.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <math.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char tableMagic[8] = { 'R', 'S', 'C', 'T', 'A', 'B', '1', 0 };
+
+RSCTable::RSCTable(const string& file) : header(0),
+										 values(0),
+										 step(0),
+										 binWidth(0),
+										 mapping(0),
+										 mappingSize(0),
+										 buffer()
+{
+	const char* data = 0;
+	size_t size = 0;
+#ifndef _WIN32
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw runtime_error("Could not open RSC table " + file);
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		this->mappingSize = (size_t)st.st_size;
+		this->mapping = mmap(0, this->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (this->mapping == MAP_FAILED)
+			this->mapping = 0;
+	}
+	close(fd);
+	if (!this->mapping)
+		throw runtime_error("Could not map RSC table " + file);
+	data = (const char*)this->mapping;
+	size = this->mappingSize;
+#else
+	ifstream is(file, ios::binary);
+	if (!is)
+		throw runtime_error("Could not open RSC table " + file);
+	this->buffer.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+	data = this->buffer.data();
+	size = this->buffer.size();
+#endif
+	this->header = (const Header*)data;
+	if (size < sizeof(Header) || memcmp(this->header->magic, tableMagic, sizeof(tableMagic)) || this->header->cols < 2 || this->header->headingBins < 1
+		|| size != sizeof(Header) + sizeof(float) * this->header->cols * this->header->cols * this->header->headingBins)
+	{
+		this->release();
+		throw runtime_error("Invalid RSC table " + file);
+	}
+	this->values = (const float*)(data + sizeof(Header));
+	this->step = this->header->extent / (this->header->cols - 1);
+	this->binWidth = CV_2PI / this->header->headingBins;
+}
+
+RSCTable::~RSCTable()
+{
+	this->release();
+}
+
+void RSCTable::release()
+{
+#ifndef _WIN32
+	if (this->mapping)
+		munmap(this->mapping, this->mappingSize);
+	this->mapping = 0;
+#endif
+}
+
+// Headings are sampled from -pi, x and y from 0 to extent. The error bound is the longest path
+// to any pose within one cell diagonal and one heading step of the origin.
+void RSCTable::generate(const string& file, float extent, int cols, int headingBins)
+{
+	float step = extent / (cols - 1);
+	float binWidth = CV_2PI / headingBins;
+	Header header;
+	memcpy(header.magic, tableMagic, sizeof(tableMagic));
+	header.cols = cols;
+	header.headingBins = headingBins;
+	header.extent = extent;
+	header.errorBound = 0;
+	float diagonal = step * sqrt(2.0f);
+	for (int r = 1; r <= 8; r++)
+	{
+		for (int a = 0; a < 256; a++)
+		{
+			for (int h = -16; h <= 16; h++)
+			{
+				float angle = CV_2PI * a / 256;
+				Point2f offset(diagonal * r / 8 * cos(angle), diagonal * r / 8 * sin(angle));
+				header.errorBound = max(header.errorBound, planShortestPath(offset, binWidth * h / 16, 1).length);
+			}
+		}
+	}
+
+	vector<float> values((size_t)cols * cols * headingBins);
+	for (int iy = 0; iy < cols; iy++)
+		for (int ix = 0; ix < cols; ix++)
+			for (int b = 0; b < headingBins; b++)
+				values[((size_t)iy * cols + ix) * headingBins + b] = planShortestPath(Point2f(ix * step, iy * step), -CV_PI + b * binWidth, 1).length;
+
+	ofstream os(file, ios::binary);
+	os.write((const char*)&header, sizeof(header));
+	os.write((const char*)values.data(), sizeof(float) * values.size());
+	if (!os)
+		throw runtime_error("Could not write RSC table " + file);
+}
+
+float RSCTable::lookup(float x, float y, float phi) const
+{
+	if (x < 0)
+	{
+		x = -x;
+		phi = -phi;
+	}
+	if (y < 0)
+	{
+		y = -y;
+		phi = -phi;
+	}
+	if (x > this->header->extent || y > this->header->extent)
+		return -1;
+
+	int cols = this->header->cols;
+	int bins = this->header->headingBins;
+	float fx = x / this->step;
+	float fy = y / this->step;
+	float fb = (phi + (float)CV_PI) / this->binWidth;
+	int ix = min((int)fx, cols - 2);
+	int iy = min((int)fy, cols - 2);
+	int b0 = (int)floor(fb);
+	fx -= ix;
+	fy -= iy;
+	fb -= b0;
+	b0 = ((b0 % bins) + bins) % bins;
+	int b1 = (b0 + 1) % bins;
+
+	const float* row0 = this->values + ((size_t)iy * cols + ix) * bins;
+	const float* row1 = row0 + (size_t)cols * bins;
+	float v00 = row0[b0] + (row0[b1] - row0[b0]) * fb;
+	float v01 = row0[bins + b0] + (row0[bins + b1] - row0[bins + b0]) * fb;
+	float v10 = row1[b0] + (row1[b1] - row1[b0]) * fb;
+	float v11 = row1[bins + b0] + (row1[bins + b1] - row1[bins + b0]) * fb;
+	float v0 = v00 + (v01 - v00) * fx;
+	float v1 = v10 + (v11 - v10) * fx;
+	return v0 + (v1 - v0) * fy;
+}
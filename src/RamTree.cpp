@@ -1,44 +1,111 @@
 #include "RamTree.h"
 #include "Map.h"
-#include <random>
-#include <chrono>
 #include "brutil.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
 
-vector< vector<PathElem>(*)(Point2f, float, float) > RamTreeNode::plans = vector< vector<PathElem>(*)(Point2f, float, float) >({ &planPath1,
-																																 &planPath2/*,
-																																 &planPath2,
-																																 &planPath4,
-																																 &planPath5 */});
-
+namespace
+{
+	// Cell size and heading bins that tell failed edges apart in the failure memo.
+	const float memoResolution = 0.25f;
+	const int memoHeadingBins = 32;
+}
 
-void RamTreeNode::setSegments(const AbstractTrajectory& traj)
+void RamTreeNode::setEdges(const AbstractTrajectory& traj)
 {
-	for (vector<AbstractSegment*>::const_iterator it = traj.segments.begin(); it != traj.segments.end(); it++)
-		this->segments.push_back((*it)->WTFNewSegment(this->tree->map));
+	this->edgeCount = (int)traj.segments.size();
+	this->firstEdge = (int)this->tree->edges.claim(this->edgeCount);
+	for (int i = 0; i < this->edgeCount; i++)
+	{
+		if (this->tree->reversed)
+			this->tree->edges[this->firstEdge + i] = traj.segments[this->edgeCount - 1 - i]->toRecord().reversed();
+		else
+			this->tree->edges[this->firstEdge + i] = traj.segments[i]->toRecord();
+	}
+	this->tree->edges.publish(this->firstEdge, this->edgeCount);
 }
 
 RamTreeNode::RamTreeNode(RamTree* tree, const Point2f& pos, const Vec2f ori) : tree(tree),
 																				pos(pos),
-																				parent(0),
-																				childs(),
-																				segments(),
+																				firstEdge(0),
+																				edgeCount(0),
 																				dist(0),
-																				rootDist(0)
+																				rootDist(0),
+																				validated(true),
+																				parent(0),
+																				childs()
 {
 	this->ori = normalize(ori);
+	this->clearFailures();
 }
 
 RamTreeNode::RamTreeNode(RamTree* tree, RamTreeNode* parent, const AbstractTrajectory& traj) : tree(tree),
+																			dist(traj.length),
+																			validated(true),
 																			parent(parent),
-																			childs(),
-																			segments(),
-																			dist(traj.length)
+																			childs()
 {
+	this->clearFailures();
 	this->rootDist = this->parent->getRootDist() + this->dist;
-	this->setSegments(traj);
-	int lastSegmentIndex = this->segments.size() - 1;
+	this->setEdges(traj);
 	this->pos = traj.endPos;
 	this->ori = traj.endOri;
+	this->parent->addChild(this);
+}
+
+// Reattaches the node below a new parent. traj has to lead from the parent to this node.
+void RamTreeNode::setParent(RamTreeNode* parent, const AbstractTrajectory& traj)
+{
+	this->parent->removeChild(this);
+	parent->addChild(this);
+	this->dist = traj.length;
+	this->setEdges(traj);
+	this->updateRootDist();
+}
+
+// Recomputes rootDist for this node and its whole subtree.
+void RamTreeNode::updateRootDist()
+{
+	vector<RamTreeNode*> stack(1, this);
+	while (stack.size())
+	{
+		RamTreeNode* node = stack.back();
+		stack.pop_back();
+		node->rootDist = node->parent->rootDist + node->dist;
+		stack.insert(stack.end(), node->childs.begin(), node->childs.end());
+	}
+}
+
+void RamTreeNode::clearFailures()
+{
+	for (int i = 0; i < failureMemoSize; i++)
+		this->failedEdges[i] = 0;
+	this->failures = 0;
+}
+
+unsigned RamTreeNode::edgeKey(const Point2f& pos, const Vec2f& ori) const
+{
+	Point2f rel = pos - this->pos;
+	int x = (int)floor((rel.x * this->ori[0] + rel.y * this->ori[1]) / memoResolution);
+	int y = (int)floor((rel.y * this->ori[0] - rel.x * this->ori[1]) / memoResolution);
+	float turn = atan2(this->ori[0] * ori[1] - this->ori[1] * ori[0], this->ori.dot(ori));
+	int bin = ((int)floor(turn * memoHeadingBins / (2 * CV_PI) + 0.5f) + memoHeadingBins) % memoHeadingBins;
+	return 1u << 31 | (unsigned)bin << 20 | ((unsigned)y & 0x3ff) << 10 | ((unsigned)x & 0x3ff);
+}
+
+bool RamTreeNode::hasFailed(unsigned key) const
+{
+	for (int i = 0; i < failureMemoSize; i++)
+		if (this->failedEdges[i].load(memory_order_relaxed) == key)
+			return true;
+	return false;
+}
+
+void RamTreeNode::addFailure(unsigned key)
+{
+	int slot = this->failures.fetch_add(1, memory_order_relaxed) % failureMemoSize;
+	this->failedEdges[slot].store(key, memory_order_relaxed);
 }
 
 RamTreeNode::~RamTreeNode()
@@ -48,50 +115,15 @@ RamTreeNode::~RamTreeNode()
 		(*it)->parent = this->parent;
 		this->parent->addChild(*it);
 	}
-	for (vector<Segment*>::iterator it = this->segments.begin(); it != this->segments.end(); it++)
-	{
-		delete *it;
-	}
 }
 
-vector<PathElem> RamTreeNode::calculateDist(const Point2f& pos, const Vec2f ori)
+RSCPath RamTreeNode::calculateDist(const Point2f& pos, const Vec2f ori, float upperBound)
 {
 	float theta = getAngleBetween(this->ori, ori);
 	Point2f target, preTarget = pos - this->pos;
 	float phi = getAngleBetween(this->ori, Vec2f(1, 0));
 	target = rotateVector(preTarget, phi);
-	vector<vector<PathElem>> paths;
-	for (int i = 0; i < RamTreeNode::plans.size(); i++)
-	{
-		vector<PathElem> tempPathElems = plans[i](target, theta, this->tree->getMinTurnRadius());
-		if (tempPathElems.size())
-		{
-			paths.push_back(tempPathElems);
-		}
-		
-		tempPathElems = plans[i](Point2f(-target.x, target.y), -theta, this->tree->getMinTurnRadius());
-		if (tempPathElems.size())
-		{
-			reverse(tempPathElems);
-			paths.push_back(tempPathElems);
-		}
-		
-		tempPathElems = plans[i](Point2f(target.x, -target.y), -theta, this->tree->getMinTurnRadius());
-		if (tempPathElems.size())
-		{
-			mirror(tempPathElems);
-			paths.push_back(tempPathElems);
-		}
-		
-		tempPathElems = plans[i](Point2f(-target.x, -target.y), theta, this->tree->getMinTurnRadius());
-		if (tempPathElems.size())
-		{
-			reverse(tempPathElems);
-			mirror(tempPathElems);
-			paths.push_back(tempPathElems);
-		}
-	}
-	return rscMin(paths);
+	return planShortestPath(target, theta, this->tree->getMinTurnRadius(), upperBound);
 }
 
 float RamTreeNode::calculateEucledeanDist(const Point2f& pos)
@@ -101,78 +133,177 @@ float RamTreeNode::calculateEucledeanDist(const Point2f& pos)
 
 void RamTreeNode::addChild(RamTreeNode* child)
 {
+	lock_guard<mutex> lock(this->tree->childMutex);
 	this->childs.push_back(child);
 	child->parent = this;
 }
 
+void RamTreeNode::removeChild(RamTreeNode* child)
+{
+	lock_guard<mutex> lock(this->tree->childMutex);
+	this->childs.erase(std::remove(this->childs.begin(), this->childs.end(), child), this->childs.end());
+}
+
 void RamTreeNode::draw()
 {
-	for (vector<Segment*>::iterator it = this->segments.begin(); it != this->segments.end(); it++)
-	{
-		(*it)->draw();
-	}
+	if (!this->parent)
+		return;
+	Trajectory t(this->tree->map, this->tree->reversed ? this->pos : this->parent->pos, this->tree->reversed ? this->ori : this->parent->ori);
+	this->tree->appendEdges(this, t);
+	t.draw();
 }
 
+// Targets in reach are tried in order of their estimated RSC length, so the first connection
+// made tends to be the shortest one.
 bool RamTree::checkTarget(RamTreeNode* node)
 {
+	vector<pair<float, CarConfiguration*>> inReach;
+	float heading = atan2(node->ori[1], node->ori[0]);
 	for (vector<CarConfiguration*>::iterator it = this->targets.begin(); it != this->targets.end(); it++)
-	{
 		if (node->calculateEucledeanDist((*it)->pos) < targetProximity)
+			inReach.push_back(make_pair(this->index.estimate(node->pos, heading, (*it)->pos, atan2((*it)->ori[1], (*it)->ori[0])), *it));
+	sort(inReach.begin(), inReach.end(), [](const pair<float, CarConfiguration*>& a, const pair<float, CarConfiguration*>& b) { return a.first < b.first; });
+	for (vector<pair<float, CarConfiguration*>>::iterator it = inReach.begin(); it != inReach.end(); it++)
+	{
+		float chainLength = 0;
+		for (CarConfiguration* config = it->second; config->parent; config = config->parent)
+			chainLength += config->t->getLength();
+		// When optimizing, only connections shorter than the current one are of interest.
+		float upperBound = numeric_limits<float>::infinity();
+		if (this->settings.optimize && this->targetReached)
+		{
+			lock_guard<mutex> lock(this->targetMutex);
+			upperBound = this->targetNode->getRootDist() - node->getRootDist() - chainLength;
+		}
+		RSCPath shortestRSC = node->calculateDist(it->second->pos, it->second->ori, upperBound);
+		if (shortestRSC.size())
 		{
-			vector<PathElem> shortestRSC = node->calculateDist((*it)->pos, (*it)->ori);
-			if (shortestRSC.size())
+			lock_guard<mutex> lock(this->targetMutex);
+			if (this->targetReached)
 			{
-				bool truncated = false;
-				NearestNode nn{ node, shortestRSC, sumRSCPath(shortestRSC) };
-				this->targetReached = true;
-				RamTreeNode* newNode = 0;
-				this->addNode(nn, -1, truncated, newNode, true);
-				if (!truncated)
+				// When optimizing, a new connection replaces the current one if it is shorter.
+				if (!this->settings.optimize)
+					return false;
+				if (node->getRootDist() + shortestRSC.length + chainLength >= this->targetNode->getRootDist())
+					continue;
+			}
+			bool truncated = false;
+			NearestNode nn{ node, shortestRSC };
+			RamTreeNode* newNode = 0;
+			this->addNode(nn, -1, truncated, newNode, true);
+			if (newNode && !truncated)
+			{
+				CarConfiguration* config = it->second;
+				while (config->parent)
 				{
-					CarConfiguration* config = *it;
-					while (config->parent)
-					{
-						newNode = this->addFixNode(newNode, config->t);
-						config = config->parent;
-					}
-					return true;
+					newNode = this->addFixNode(newNode, config->t);
+					config = config->parent;
 				}
-				else
-					this->targetReached = false;
+				this->targetReached = true;
+				// Lazily added edges are only stepped through now that they lead to the target.
+				return !this->lazy || this->validatePath();
 			}
 		}
 	}
 	return false;
 }
 
-RamTree::RamTree(Map* map, const Point2f& pos, const Vec2f ori, const vector<CarConfiguration*>& targets, float minTurnRadius, float increment, float targetProximity) : map(map),
+// Steps through the unchecked edges from the root to the target node. The first invalid one is
+// cut off with everything behind it, which includes the target node, and the target is given up.
+bool RamTree::validatePath()
+{
+	vector<RamTreeNode*> path;
+	for (RamTreeNode* node = this->targetNode; node->parent; node = node->parent)
+		path.push_back(node);
+	for (vector<RamTreeNode*>::reverse_iterator it = path.rbegin(); it != path.rend(); it++)
+	{
+		if ((*it)->validated)
+			continue;
+		AbstractTrajectory traj((*it)->parent->pos, (*it)->parent->ori, 0.1f);
+		this->appendEdges(*it, traj);
+		bool truncated = false;
+		if (!traj.truncate(this->map, -1, truncated, 0.1f) || truncated)
+		{
+			this->discard(*it);
+			this->targetNode = 0;
+			this->targetReached = false;
+			return false;
+		}
+		(*it)->validated = true;
+	}
+	return true;
+}
+
+// Unlinks node and its subtree from the tree and the index. The nodes are kept in vertices,
+// without parent or children, until the tree is deleted.
+void RamTree::discard(RamTreeNode* node)
+{
+	node->parent->removeChild(node);
+	vector<RamTreeNode*> stack(1, node);
+	while (stack.size())
+	{
+		RamTreeNode* next = stack.back();
+		stack.pop_back();
+		this->index.remove(next);
+		stack.insert(stack.end(), next->childs.begin(), next->childs.end());
+		next->childs.clear();
+		next->parent = 0;
+	}
+}
+
+RamTree::RamTree(Map* map, const Point2f& pos, const Vec2f ori, const vector<CarConfiguration*>& targets, const PlannerSettings& settings, float minTurnRadius, float increment, float targetProximity) : map(map),
 	                                                                                                                                      targetProximity(targetProximity),
 	                                                                                                                                      increment(increment),
 																																		  targetReached(false),
 																																		  minTurnRadius(minTurnRadius),
+																																		  reversed(false),
+																																		  lazy(settings.lazy && !settings.optimize && !settings.bidirectional && (settings.portfolioSize > 1 || settings.growthThreads <= 1)),
+																																		  index(map->getXMin(), map->getXMax(), map->getYMin(), map->getYMax(), minTurnRadius, settings.rscTable),
+																																		  settings(settings),
 																																		  targetNode()
 {
 	this->targets = targets;
+	this->sampler = Sampler::create(settings.sampler, settings.seed, map->getXMin(), map->getXMax(), map->getYMin(), map->getYMax(), this->targets, settings.goalBias);
 	RamTreeNode* newNode = new RamTreeNode(this, pos, ori);
 	this->vertices.push_back(newNode);
+	this->index.insert(newNode);
 }
 
-NearestNode RamTree::findNearestNode(const Point2f& pos, const Vec2f ori)
+// Goal tree for bidirectional planning. It is rooted at the pre-target without a parent and
+// starts out with the backup manoeuvres of the other pre-targets as its first edges.
+RamTree::RamTree(Map* map, const vector<CarConfiguration*>& preTargets, const PlannerSettings& settings, float minTurnRadius, float increment) : map(map),
+																																				  targetProximity(0),
+																																				  increment(increment),
+																																				  targetReached(false),
+																																				  minTurnRadius(minTurnRadius),
+																																				  reversed(true),
+																																				  lazy(false),
+																																				  index(map->getXMin(), map->getXMax(), map->getYMin(), map->getYMax(), minTurnRadius, settings.rscTable),
+																																				  settings(settings),
+																																				  targetNode()
 {
-	RamTreeNode* minNode = 0;
-	vector<PathElem> shortestRSC;
-	for (vector<RamTreeNode*>::iterator it = this->vertices.begin(); it != this->vertices.end(); it++)
+	this->sampler = Sampler::create(settings.sampler, settings.seed, map->getXMin(), map->getXMax(), map->getYMin(), map->getYMax(), this->targets, settings.goalBias);
+	for (size_t i = 0; i < preTargets.size(); i++)
 	{
-		vector<PathElem> currRSC = (*it)->calculateDist(pos, ori);
-		if (!currRSC.size())
-			continue;
-		if (!shortestRSC.size() || rscComp(currRSC, shortestRSC))
+		CarConfiguration* config = preTargets[i];
+		RamTreeNode* newNode = 0;
+		if (!config->parent)
+			newNode = new RamTreeNode(this, config->pos, config->ori);
+		else
 		{
-			shortestRSC = currRSC;
-			minNode = *it;
+			size_t parent = find(preTargets.begin(), preTargets.begin() + i, config->parent) - preTargets.begin();
+			AbstractTrajectory* traj = this->reversePath(*config->t);
+			newNode = new RamTreeNode(this, this->vertices[parent], *traj);
+			delete traj;
 		}
+		this->vertices.push_back(newNode);
+		this->index.insert(newNode);
 	}
-	return NearestNode{ minNode, shortestRSC, sumRSCPath(shortestRSC) };
+}
+
+NearestNode RamTree::findNearestNode(const Point2f& pos, const Vec2f ori)
+{
+	return this->index.findNearest(pos, ori);
 }
 
 bool RamTree::addNode(NearestNode& nearestNode, float truncLength, bool& truncated, RamTreeNode*& newNode, bool isTarget)
@@ -180,30 +311,133 @@ bool RamTree::addNode(NearestNode& nearestNode, float truncLength, bool& truncat
 	AbstractTrajectory* traj = this->truncatePath(nearestNode, truncLength, truncated);
 	if (!traj)
 		return false;
+	vector<RamTreeNode*> near;
+	if (this->settings.optimize && !isTarget)
+	{
+		this->index.findNear(traj->getEndPos(), traj->getEndOri(), this->nearRadius(), near);
+		traj = this->chooseParent(nearestNode, traj, near);
+	}
 	newNode = new RamTreeNode(this, nearestNode.node, *traj);
+	newNode->validated = !this->lazy;
 	delete traj;
 	this->vertices.push_back(newNode);
+	this->index.insert(newNode);
+	if (near.size())
+		this->rewire(newNode, near);
 	if (isTarget && !truncated)
 		this->targetNode = newNode;
-	if (!this->targetReached && checkTarget(newNode))
+	if (!isTarget && !this->targetReached && checkTarget(newNode))
 		return true;
 	return false;
 }
 
 RamTreeNode* RamTree::addFixNode(RamTreeNode* nearestNode, AbstractTrajectory* t)
 {
-	RamTreeNode* newNode = new RamTreeNode(this, nearestNode, *t);
-	this->vertices.push_back(newNode);
+	RamTreeNode* newNode = this->attachNode(nearestNode, *t);
 	this->targetNode = newNode;
 	return newNode;
 }
 
-AbstractTrajectory* RamTree::truncatePath(NearestNode& nearestNode, float truncLength, bool& truncated, float stepsize)
+RamTreeNode* RamTree::attachNode(RamTreeNode* parent, const AbstractTrajectory& traj)
+{
+	RamTreeNode* newNode = new RamTreeNode(this, parent, traj);
+	this->vertices.push_back(newNode);
+	this->index.insert(newNode);
+	return newNode;
+}
+
+// Completes the path through the goal tree: node reaches goalNode over bridge, and from there
+// the goal tree edges lead to its root. They are copied in as fix nodes, like the pre-target chain.
+bool RamTree::graft(RamTreeNode* node, const AbstractTrajectory& bridge, const RamTree* goal, const RamTreeNode* goalNode)
+{
+	lock_guard<mutex> lock(this->targetMutex);
+	if (this->targetReached)
+		return false;
+	RamTreeNode* newNode = this->attachNode(node, bridge);
+	for (; goalNode->parent; goalNode = goalNode->parent)
+	{
+		AbstractTrajectory t(newNode->pos, newNode->ori);
+		goal->appendEdges(goalNode, t);
+		newNode = this->attachNode(newNode, t);
+	}
+	this->targetNode = newNode;
+	this->targetReached = true;
+	return true;
+}
+
+// The path driven backwards, from the end pose of traj to its start.
+AbstractTrajectory* RamTree::reversePath(const AbstractTrajectory& traj) const
+{
+	AbstractTrajectory* reversed = new AbstractTrajectory(traj.endPos, traj.endOri);
+	for (vector<AbstractSegment*>::const_reverse_iterator it = traj.segments.rbegin(); it != traj.segments.rend(); it++)
+		reversed->addRecord((*it)->toRecord().reversed(), this->minTurnRadius);
+	return reversed;
+}
+
+// Shrinking RRT* neighbourhood, gamma * (log(n) / n)^(1/3), but never below one extension step.
+float RamTree::nearRadius() const
+{
+	float n = (float)this->vertices.size() + 1;
+	return max(this->increment, this->settings.rewireGamma * pow(log(n) / n, 1.0f / 3));
+}
+
+// Picks the near node that reaches the end of traj with the lowest rootDist. Candidates are
+// tried cheapest first, so only the winner and the colliding ones are collision checked.
+AbstractTrajectory* RamTree::chooseParent(NearestNode& nearestNode, AbstractTrajectory* traj, const vector<RamTreeNode*>& near)
+{
+	Point2f endPos = traj->getEndPos();
+	Vec2f endOri = traj->getEndOri();
+	float best = nearestNode.node->getRootDist() + traj->getLength();
+	vector<pair<float, NearestNode>> candidates;
+	for (vector<RamTreeNode*>::const_iterator it = near.begin(); it != near.end(); it++)
+	{
+		if (*it == nearestNode.node || (*it)->getRootDist() >= best)
+			continue;
+		RSCPath rsc = (*it)->calculateDist(endPos, endOri, best - (*it)->getRootDist());
+		if (rsc.size() && (*it)->getRootDist() + rsc.length < best)
+			candidates.push_back(make_pair((*it)->getRootDist() + rsc.length, NearestNode{ *it, rsc }));
+	}
+	sort(candidates.begin(), candidates.end(), [](const pair<float, NearestNode>& a, const pair<float, NearestNode>& b) { return a.first < b.first; });
+	for (vector<pair<float, NearestNode>>::iterator it = candidates.begin(); it != candidates.end(); it++)
+	{
+		bool truncated = false;
+		AbstractTrajectory* better = this->truncatePath(it->second, -1, truncated);
+		if (better)
+		{
+			delete traj;
+			nearestNode = it->second;
+			return better;
+		}
+	}
+	return traj;
+}
+
+// Routes near nodes through node wherever that shortens their rootDist.
+void RamTree::rewire(RamTreeNode* node, const vector<RamTreeNode*>& near)
+{
+	for (vector<RamTreeNode*>::const_iterator it = near.begin(); it != near.end(); it++)
+	{
+		if (*it == node->parent || !(*it)->parent || node->getRootDist() >= (*it)->getRootDist())
+			continue;
+		RSCPath rsc = node->calculateDist((*it)->getPos(), (*it)->getOri(), (*it)->getRootDist() - node->getRootDist());
+		if (!rsc.size() || node->getRootDist() + rsc.length >= (*it)->getRootDist())
+			continue;
+		bool truncated = false;
+		NearestNode nn{ node, rsc };
+		AbstractTrajectory* traj = this->truncatePath(nn, -1, truncated);
+		if (!traj)
+			continue;
+		(*it)->setParent(node, *traj);
+		delete traj;
+	}
+}
+
+AbstractTrajectory* RamTree::truncatePath(NearestNode& nearestNode, float truncLength, bool& truncated, float stepsize, bool useChunk)
 {
 	Point2f segStartPos = nearestNode.node->getPos();
 	Vec2f segStartOri = nearestNode.node->getOri();
 	AbstractTrajectory* traj = new AbstractTrajectory(segStartPos, segStartOri, stepsize);
-	for (vector<PathElem>::const_iterator it = nearestNode.path.begin(); it != nearestNode.path.end(); it++)
+	for (const PathElem* it = nearestNode.path.begin(); it != nearestNode.path.end(); it++)
 	{
 		if (it->isCurve)
 		{
@@ -217,8 +451,37 @@ AbstractTrajectory* RamTree::truncatePath(NearestNode& nearestNode, float truncL
 			segStartPos = traj->getEndPos();
 		}
 	}
-	if (!traj->truncate(this->map, truncLength, truncated, stepsize))
+	// An extension that ends where one from the same node already ran into an obstacle is given
+	// up on without stepping through it again.
+	unsigned failureKey = 0;
+	if (this->settings.failureMemo && truncLength >= 0)
 	{
+		traj->step((int)ceil(truncLength / stepsize));
+		failureKey = nearestNode.node->edgeKey(traj->getCurrPos(), traj->currOri);
+		traj->resetState();
+		if (nearestNode.node->hasFailed(failureKey))
+		{
+			delete traj;
+			return 0;
+		}
+	}
+	if (this->lazy)
+	{
+		// Only the end pose is checked. The rest waits until the edge is part of a path.
+		traj->cut(truncLength, truncated);
+		if (this->map->checkCollision(traj->getEndPos(), traj->getEndOri(), stepsize))
+		{
+			if (failureKey)
+				nearestNode.node->addFailure(failureKey);
+			delete traj;
+			return 0;
+		}
+		return traj;
+	}
+	if (!traj->truncate(this->map, truncLength, truncated, stepsize, useChunk))
+	{
+		if (failureKey)
+			nearestNode.node->addFailure(failureKey);
 		delete traj;
 		return 0;
 	}
@@ -227,25 +490,25 @@ AbstractTrajectory* RamTree::truncatePath(NearestNode& nearestNode, float truncL
 
 void RamTree::draw()
 {
-	for (vector<RamTreeNode*>::iterator it = this->vertices.begin(); it != this->vertices.end(); it++)
+	for (size_t i = 0; i < this->vertices.size(); i++)
 	{
-		(*it)->draw();
+		this->vertices[i]->draw();
 	}
 }
 
 bool RamTree::addRRTNode()
+{
+	return this->addRRTNode(this->sampler);
+}
+
+bool RamTree::addRRTNode(Sampler* sampler)
 {
 	if (this->vertices.size() == 1)
 		if (checkTarget(this->vertices[0]))
 			return true;
-	unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-	std::default_random_engine generator(seed);
-	std::uniform_real_distribution<double> distributionX(this->map->getXMin(), this->map->getXMax());
-	std::uniform_real_distribution<double> distributionY(this->map->getYMin(), this->map->getYMax());
-	std::uniform_real_distribution<double> distributionPhi(0, CV_2PI);
-	Point2f randomPoint(distributionX(generator), distributionY(generator));
-	float randomPhi = distributionPhi(generator);
-	Vec2f randomOri(cos(randomPhi), sin(randomPhi));
+	Point2f randomPoint;
+	Vec2f randomOri;
+	sampler->sample(randomPoint, randomOri);
 	NearestNode nearestNode = this->findNearestNode(randomPoint, randomOri);
 	if (!nearestNode.node)
 		return false;
@@ -256,6 +519,47 @@ bool RamTree::addRRTNode()
 	return false;
 }
 
+// One RRT-Connect iteration. Either this tree or the goal tree is extended towards a random sample,
+// then the other tree steers to the new node with RSC as far as it gets without collision.
+// Returns true once the two trees are joined.
+bool RamTree::addConnectNode(RamTree* goal, bool growGoal)
+{
+	RamTree* grown = growGoal ? goal : this;
+	RamTree* other = growGoal ? this : goal;
+	Point2f randomPoint;
+	Vec2f randomOri;
+	grown->sampler->sample(randomPoint, randomOri);
+	NearestNode nearestNode = grown->findNearestNode(randomPoint, randomOri);
+	if (!nearestNode.node)
+		return false;
+	bool truncated = false;
+	RamTreeNode* newNode = 0;
+	if (grown->addNode(nearestNode, grown->increment, truncated, newNode))
+		return true;
+	if (!newNode)
+		return false;
+
+	NearestNode bridge = other->findNearestNode(newNode->pos, newNode->ori);
+	if (!bridge.node)
+		return false;
+	AbstractTrajectory* traj = other->truncatePath(bridge, -1, truncated, 0.1, true);
+	if (!traj)
+		return false;
+	bool joined = false;
+	if (truncated)
+		other->attachNode(bridge.node, *traj);
+	else if (growGoal)
+		joined = this->graft(bridge.node, *traj, goal, newNode);
+	else
+	{
+		AbstractTrajectory* back = this->reversePath(*traj);
+		joined = this->graft(newNode, *back, goal, bridge.node);
+		delete back;
+	}
+	delete traj;
+	return joined;
+}
+
 void  RamTree::growRRT(int steps)
 {
 	for (int i = 0; i < steps; i++)
@@ -265,46 +569,68 @@ void  RamTree::growRRT(int steps)
 	}
 }
 
+// Grows this tree from several threads until the budget runs out. Sampling, the nearest node
+// query and edge validation run in parallel; new nodes are published without locking.
+bool RamTree::growConcurrent(int threads, const PlanBudget& budget)
+{
+	vector<Sampler*> samplers(1, this->sampler);
+	for (int i = 1; i < threads; i++)
+		samplers.push_back(Sampler::create(this->settings.sampler, this->settings.seed ^ (0x9E3779B9u * i), this->map->getXMin(), this->map->getXMax(), this->map->getYMin(), this->map->getYMax(), this->targets, this->settings.goalBias));
+
+	vector<thread> workers;
+	for (int i = 0; i < threads; i++)
+	{
+		workers.push_back(thread([this, &samplers, &budget, i]()
+		{
+			for (int step = 0; !this->targetReached && !budget.exhausted(step); step++)
+			{
+				if (this->addRRTNode(samplers[i]))
+					return;
+			}
+		}));
+	}
+	for (vector<thread>::iterator it = workers.begin(); it != workers.end(); it++)
+		it->join();
+	for (int i = 1; i < threads; i++)
+		delete samplers[i];
+	return this->targetReached;
+}
+
+float RamTree::getBestCost() const
+{
+	if (!this->targetReached)
+		return numeric_limits<float>::infinity();
+	return this->targetNode->getRootDist();
+}
+
 Trajectory* RamTree::composeTrajectoryFromTree()
 {
 	if (!this->targetReached)
 		return 0;
-	
-	vector<Segment*> reverseSegments;
+
+	vector<RamTreeNode*> reverseNodes;
+	int edgeCount = 0;
 	RamTreeNode* tempNode = this->targetNode;
 	while (tempNode != this->vertices[0])
 	{
-		for (int i = tempNode->segments.size() - 1;  i >= 0; i--)
-		{
-			reverseSegments.push_back(tempNode->segments[i]);
-		}
+		reverseNodes.push_back(tempNode);
+		edgeCount += tempNode->edgeCount;
 		tempNode = tempNode->parent;
 	}
-	if (!reverseSegments.size())
+	if (!edgeCount)
 		return 0;
 	Trajectory* t = new Trajectory(this->map, this->vertices[0]->pos, this->vertices[0]->ori);
-	while (!reverseSegments.empty())
-	{
-		Segment* last = reverseSegments[reverseSegments.size()-1];
-		if (last->antipattern() == 0)
-		{
-			LinearSegment* llast = dynamic_cast<LinearSegment*>(last);
-			t->addLinearSegment(last->getLength(), llast->getDirection() == 1);
-		}
-		else
-		{
-			CurveSegment* clast = dynamic_cast<CurveSegment*>(last);
-			t->addCurveSegment(clast->getAngle(), clast->getRadius(), clast->isRight());
-		}
-		reverseSegments.pop_back();
-	}
+	for (vector<RamTreeNode*>::reverse_iterator it = reverseNodes.rbegin(); it != reverseNodes.rend(); it++)
+		this->appendEdges(*it, *t);
 	return t;
 }
 
 RamTree::~RamTree()
 {
-	for (vector<RamTreeNode*>::iterator it = this->vertices.begin(); it != this->vertices.end(); it++)
+	delete this->sampler;
+	for (size_t i = 0; i < this->vertices.size(); i++)
 	{
-		delete *it;
-	} 
+		this->vertices[i]->childs.clear();
+		delete this->vertices[i];
+	}
 }
@@ -0,0 +1,99 @@
+#include "Sampler.h"
+
+#include <math.h>
+
+Sampler::Sampler(float x_min, float x_max, float y_min, float y_max) : x_min(x_min),
+																		x_max(x_max),
+																		y_min(y_min),
+																		y_max(y_max)
+{
+}
+
+Sampler* Sampler::create(Strategy strategy, unsigned seed, float x_min, float x_max, float y_min, float y_max, const vector<CarConfiguration*>& targets, float goalBias)
+{
+	switch (strategy)
+	{
+	case GOAL_BIASED:
+		return new GoalBiasedSampler(seed, x_min, x_max, y_min, y_max, targets, goalBias);
+	case HALTON:
+		return new HaltonSampler(seed, x_min, x_max, y_min, y_max);
+	case UNIFORM:
+	default:
+		return new UniformSampler(seed, x_min, x_max, y_min, y_max);
+	}
+}
+
+UniformSampler::UniformSampler(unsigned seed, float x_min, float x_max, float y_min, float y_max) : Sampler(x_min, x_max, y_min, y_max),
+																									generator(seed),
+																									distributionX(x_min, x_max),
+																									distributionY(y_min, y_max),
+																									distributionPhi(0, CV_2PI)
+{
+}
+
+void UniformSampler::sample(Point2f& pos, Vec2f& ori)
+{
+	pos.x = this->distributionX(this->generator);
+	pos.y = this->distributionY(this->generator);
+	float phi = this->distributionPhi(this->generator);
+	ori = Vec2f(cos(phi), sin(phi));
+}
+
+GoalBiasedSampler::GoalBiasedSampler(unsigned seed, float x_min, float x_max, float y_min, float y_max, const vector<CarConfiguration*>& targets, float goalBias) : UniformSampler(seed, x_min, x_max, y_min, y_max),
+																																								  targets(targets),
+																																								  goalBias(goalBias),
+																																								  distributionBias(0, 1)
+{
+}
+
+void GoalBiasedSampler::sample(Point2f& pos, Vec2f& ori)
+{
+	if (this->targets.size() && this->distributionBias(this->generator) < this->goalBias)
+	{
+		int target = min((int)(this->distributionBias(this->generator) * this->targets.size()), (int)this->targets.size() - 1);
+		pos = this->targets[target]->pos;
+		ori = this->targets[target]->ori;
+		return;
+	}
+	UniformSampler::sample(pos, ori);
+}
+
+HaltonSampler::HaltonSampler(unsigned seed, float x_min, float x_max, float y_min, float y_max) : Sampler(x_min, x_max, y_min, y_max),
+																								  index(0)
+{
+	mt19937 generator(seed);
+	uniform_real_distribution<double> distribution(0, 1);
+	for (int i = 0; i < 3; i++)
+		this->offset[i] = distribution(generator);
+}
+
+double HaltonSampler::radicalInverse(unsigned index, unsigned base)
+{
+	double inverse = 1.0 / base;
+	double digit = inverse;
+	double result = 0;
+	while (index > 0)
+	{
+		result += digit * (index % base);
+		index /= base;
+		digit *= inverse;
+	}
+	return result;
+}
+
+void HaltonSampler::sample(Point2f& pos, Vec2f& ori)
+{
+	static const unsigned bases[3] = { 2, 3, 5 };
+	double u[3];
+	this->index++;
+	for (int i = 0; i < 3; i++)
+	{
+		u[i] = radicalInverse(this->index, bases[i]) + this->offset[i];
+		if (u[i] >= 1)
+			u[i] -= 1;
+	}
+	pos.x = (float)(this->x_min + u[0] * (this->x_max - this->x_min));
+	pos.y = (float)(this->y_min + u[1] * (this->y_max - this->y_min));
+	double phi = u[2] * CV_2PI;
+	ori = Vec2f((float)cos(phi), (float)sin(phi));
+}
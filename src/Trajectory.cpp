@@ -55,6 +55,14 @@ void Trajectory::addCurveSegment(float angle, float radius, bool right)
 	this->calculateCVPoints();
 }
 
+void Trajectory::addRecord(const EdgeRecord& record, float radius)
+{
+	if (record.isCurve)
+		this->addCurveSegment(record.angle, radius, record.right);
+	else
+		this->addLinearSegment(record.length, record.direction == 1);
+}
+
 void Trajectory::removeLastSegment()
 {
 	if (!this->segments.size())
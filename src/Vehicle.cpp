@@ -38,6 +38,8 @@ Vehicle::Vehicle(Map* map, const Point2f& pos, const Vec2f& ori, float length, f
 	this->rearAxleCenterTurnRadius = turnRadius * cos(asin((this->length - this->rearOverhang) / turnRadius)) - width / 2.0f;
 	this->ori = normalize(ori);
 	this->theta = getAngleBetween(Vec2f(1, 0), this->ori);
+	this->bodyMin = Vec2f(-this->rearOverhang, -this->width / 2);
+	this->bodyMax = Vec2f(this->length - this->rearOverhang, this->width / 2);
 	this->calculateCorners();
 	this->map = map;
 	this->cvPointCount = 4;
@@ -45,23 +47,13 @@ Vehicle::Vehicle(Map* map, const Point2f& pos, const Vec2f& ori, float length, f
 	this->calculateCVPoints();
 }
 
-const Vec2f* Vehicle::getCollZone(float customSafety) const
+void Vehicle::getCollBox(float& centerOffset, float& halfLength, float& halfWidth, float customSafety) const
 {
 	if (customSafety < 0)
 		customSafety = this->safety;
-	Vec2f oriNorm;
-	oriNorm[0] = -this->ori[1];
-	oriNorm[1] = this->ori[0];
-	Vec2f* collZoneCorners = new Vec2f[4];
-	collZoneCorners[0] = (Vec2f)this->corners[0] + customSafety * (-this->ori + oriNorm) - (Vec2f)this->pos;
-	collZoneCorners[0] = rotateVector(collZoneCorners[0], -this->theta);
-	collZoneCorners[1] = (Vec2f)this->corners[1] + customSafety * (-this->ori - oriNorm) - (Vec2f)this->pos;
-	collZoneCorners[1] = rotateVector(collZoneCorners[1], -this->theta);
-	collZoneCorners[2] = (Vec2f)this->corners[2] + customSafety * (this->ori - oriNorm) - (Vec2f)this->pos;
-	collZoneCorners[2] = rotateVector(collZoneCorners[2], -this->theta);
-	collZoneCorners[3] = (Vec2f)this->corners[3] + customSafety * (this->ori + oriNorm) - (Vec2f)this->pos;
-	collZoneCorners[3] = rotateVector(collZoneCorners[3], -this->theta);
-	return collZoneCorners;
+	centerOffset = (this->bodyMin[0] + this->bodyMax[0]) / 2;
+	halfLength = (this->bodyMax[0] - this->bodyMin[0]) / 2 + customSafety;
+	halfWidth = (this->bodyMax[1] - this->bodyMin[1]) / 2 + customSafety;
 }
 
 Vehicle::~Vehicle()
@@ -1,61 +1,186 @@
 #include <cstdio>
+#include <cstring>
+#include <chrono>
 #include <opencv2/highgui.hpp>
+#include <memory>
 #include "Map.h"
+#include "RSCTable.h"
 
+class WindowObserver : public PlanObserver
+{
+public:
+    bool onPlanStep(Map& map, const PlanProgress& /*progress*/)
+    {
+        if (waitKey(1) == 'p')
+            return false;
+        map.draw();
+        return true;
+    }
 
-int main(int argc, char** argv)
+    void onPlanFinished(Map& map, bool /*success*/)
+    {
+        map.draw();
+    }
+};
+
+int runHeadless(const char* mapFile, int spot, const PlannerSettings& settings, const PlanRequest& request)
 {
-    if (argc != 2)
+    Map map(mapFile, "BatteringRam", 640, 640);
+    map.setPlannerSettings(settings);
+    for (int i = 0; i < spot; i++)
+        map.activateNextSpot();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool found = map.plan(request);
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    if (!found)
     {
-        printf(" Usage: %s MapFileToParse\n", argv[0]);
-        return -1;
+        printf("No trajectory found: %.1f ms, seed %u\n", elapsed, settings.seed);
+        return 1;
     }
+    printf("Trajectory found: length %.2f m, %.1f ms, seed %u\n", map.getVehicle().getTraj()->getLength(), elapsed, settings.seed);
+    return 0;
+}
+
+int runWindowed(const char* mapFile, const PlannerSettings& settings, const PlanRequest& request)
+{
     namedWindow("BatteringRam", WINDOW_AUTOSIZE);
-    try
+    Map map(mapFile, "BatteringRam", 640, 640);
+    map.setPlannerSettings(settings);
+    WindowObserver observer;
+    map.setObserver(&observer);
+    setMouseCallback("BatteringRam", Map::mouseCallback, &map);
+    int frameCounter = 0;
+    int stepFreq = 12;
+    while (true)
     {
-        Map map(argv[1], "BatteringRam", 640, 640);
-        int frameCounter = 0;
-        int stepFreq = 12;
-        while (true)
-        {
-            frameCounter++;
-            int key = waitKey(16);
+        frameCounter++;
+        int key = waitKey(16);
 
-            switch (key)
-            {
-                case '[':
-                    map.activateNextSpot();
-                    break;
-                case ']':
-                    map.activateNextSpot(false);
-                    break;
-                case 'p':
-                    while (!map.planTrajectory(6000)) {};
-                    break;
-                case 's':
-                    map.startStop();
-                    break; 
-                case 'r':
-                    map.reset();
-                    break;
-                default:
-                    break;
-            }
-            if (key == 27)
+        switch (key)
+        {
+            case '[':
+                map.activateNextSpot();
                 break;
+            case ']':
+                map.activateNextSpot(false);
+                break;
+            case 'p':
+                map.plan(request);
+                break;
+            case 's':
+                map.startStop();
+                break;
+            case 'r':
+                map.reset();
+                break;
+            default:
+                break;
+        }
+        if (key == 27)
+            break;
 
-            if (frameCounter == stepFreq)
+        if (frameCounter == stepFreq)
+        {
+            map.simulateStep();
+            frameCounter = 0;
+        }
+        map.draw();
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    bool headless = false;
+    int spot = 0;
+    const char* mapFile = 0;
+    const char* tableFile = 0;
+    const char* buildTableFile = 0;
+    PlannerSettings settings;
+    PlanRequest request;
+    request.budget = 5000;
+    settings.seed = (unsigned)chrono::system_clock::now().time_since_epoch().count();
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--headless"))
+            headless = true;
+        else if (!strcmp(argv[i], "--spot") && i + 1 < argc)
+            spot = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            settings.seed = (unsigned)strtoul(argv[++i], 0, 10);
+        else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+            request.budget = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--portfolio") && i + 1 < argc)
+            settings.portfolioSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bidirectional"))
+            settings.bidirectional = true;
+        else if (!strcmp(argv[i], "--optimize"))
+            settings.optimize = true;
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            settings.growthThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--cspace") && i + 1 < argc)
+            settings.cspaceResolution = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--distance-field") && i + 1 < argc)
+            settings.distanceFieldResolution = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--lazy"))
+            settings.lazy = true;
+        else if (!strcmp(argv[i], "--failure-memo"))
+            settings.failureMemo = true;
+        else if (!strcmp(argv[i], "--rsc-table") && i + 1 < argc)
+            tableFile = argv[++i];
+        else if (!strcmp(argv[i], "--build-rsc-table") && i + 1 < argc)
+            buildTableFile = argv[++i];
+        else if (!strcmp(argv[i], "--sampler") && i + 1 < argc)
+        {
+            i++;
+            if (!strcmp(argv[i], "goal"))
+                settings.sampler = Sampler::GOAL_BIASED;
+            else if (!strcmp(argv[i], "halton"))
+                settings.sampler = Sampler::HALTON;
+            else if (!strcmp(argv[i], "uniform"))
+                settings.sampler = Sampler::UNIFORM;
+            else
             {
-                map.simulateStep();
-                frameCounter = 0;
+                mapFile = buildTableFile = 0;
+                break;
             }
-            map.draw();
+        }
+        else if (!mapFile)
+            mapFile = argv[i];
+        else
+        {
+            mapFile = 0;
+            break;
         }
     }
+    if (!mapFile && !buildTableFile)
+    {
+        printf(" Usage: %s [--headless] [--spot <index>] [--seed <n>] [--budget <ms>] [--sampler uniform|goal|halton] [--portfolio <n>] [--threads <n>] [--optimize] [--bidirectional] [--cspace <cell size>] [--distance-field <cell size>] [--lazy] [--failure-memo] [--rsc-table <file>] MapFileToParse\n", argv[0]);
+        printf("        %s --build-rsc-table <file>\n", argv[0]);
+        return -1;
+    }
+    try
+    {
+        if (buildTableFile)
+        {
+            RSCTable::generate(buildTableFile);
+            return 0;
+        }
+        unique_ptr<RSCTable> table;
+        if (tableFile)
+        {
+            table.reset(new RSCTable(tableFile));
+            settings.rscTable = table.get();
+        }
+        if (headless)
+            return runHeadless(mapFile, spot, settings, request);
+        return runWindowed(mapFile, settings, request);
+    }
     catch (runtime_error& e)
     {
         printf("%s\n", e.what());
         return -1;
     }
-    return 0;
-}
\ No newline at end of file
+}